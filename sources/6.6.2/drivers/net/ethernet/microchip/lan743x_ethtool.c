@@ -708,6 +708,11 @@ static const char lan743x_tx_queue_cnt_strings[][ETH_GSTRING_LEN] = {
 	"TX Total Queue Frames",
 };
 
+static const char lan743x_set3_sw_cnt_strings[][ETH_GSTRING_LEN] = {
+	"TX Bounced Frames",
+	"RX XDP Multi-Buffer Drops",
+};
+
 static const char lan743x_set2_hw_cnt_strings[][ETH_GSTRING_LEN] = {
 	"RX Total Frames",
 	"EEE RX LPI Transitions",
@@ -825,6 +830,13 @@ static void lan743x_ethtool_get_strings(struct net_device *netdev,
 			       lan743x_tx_queue_cnt_strings,
 			       sizeof(lan743x_tx_queue_cnt_strings));
 		}
+		memcpy(&data[sizeof(lan743x_set0_hw_cnt_strings) +
+		       sizeof(lan743x_set1_sw_cnt_strings) +
+		       sizeof(lan743x_set2_hw_cnt_strings) +
+		       (adapter->is_pci11x1x ?
+			sizeof(lan743x_tx_queue_cnt_strings) : 0)],
+		       lan743x_set3_sw_cnt_strings,
+		       sizeof(lan743x_set3_sw_cnt_strings));
 		break;
 	case ETH_SS_TEST:
 		memcpy(data, lan743x_test_info, sizeof(lan743x_test_info));
@@ -842,6 +854,8 @@ static void lan743x_ethtool_get_ethtool_stats(struct net_device *netdev,
 {
 	struct lan743x_adapter *adapter = netdev_priv(netdev);
 	u64 total_queue_count = 0;
+	u64 xdp_multi_buf_drops = 0;
+	u64 bounced_frames = 0;
 	int data_index = 0;
 	u64 pkt_cnt;
 	u32 buf;
@@ -865,6 +879,12 @@ static void lan743x_ethtool_get_ethtool_stats(struct net_device *netdev,
 		}
 		data[data_index++] = total_queue_count;
 	}
+	for (i = 0; i < adapter->used_tx_channels; i++)
+		bounced_frames += adapter->tx[i].bounced_frames;
+	data[data_index++] = bounced_frames;
+	for (i = 0; i < ARRAY_SIZE(adapter->rx); i++)
+		xdp_multi_buf_drops += adapter->rx[i].xdp_multi_buf_drops;
+	data[data_index++] = xdp_multi_buf_drops;
 }
 
 static u32 lan743x_ethtool_get_priv_flags(struct net_device *netdev)
@@ -897,6 +917,7 @@ static int lan743x_ethtool_get_sset_count(struct net_device *netdev, int sset)
 		ret += ARRAY_SIZE(lan743x_set2_hw_cnt_strings);
 		if (adapter->is_pci11x1x)
 			ret += ARRAY_SIZE(lan743x_tx_queue_cnt_strings);
+		ret += ARRAY_SIZE(lan743x_set3_sw_cnt_strings);
 		return ret;
 	}
 	case ETH_SS_TEST:
@@ -1440,7 +1461,139 @@ static int lan743x_ethtool_set_tc10(struct net_device *netdev, u8 tc10)
 	return phydev->drv->set_tc10(phydev, tc10);
 }
 
+static int lan743x_ethtool_get_coalesce(struct net_device *netdev,
+					struct ethtool_coalesce *ec,
+					struct kernel_ethtool_coalesce *kec,
+					struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	ec->rx_coalesce_usecs = adapter->rx_coalesce_usecs;
+	ec->tx_coalesce_usecs = adapter->tx_coalesce_usecs;
+	ec->use_adaptive_rx_coalesce = adapter->rx_dim_enabled;
+	ec->use_adaptive_tx_coalesce = adapter->tx_dim_enabled;
+
+	return 0;
+}
+
+static int lan743x_ethtool_set_coalesce(struct net_device *netdev,
+					struct ethtool_coalesce *ec,
+					struct kernel_ethtool_coalesce *kec,
+					struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	if (adapter->csr.flags & LAN743X_CSR_FLAG_IS_A0)
+		return -EOPNOTSUPP;
+
+	if (ec->rx_coalesce_usecs > LAN743X_INT_MOD_MAX ||
+	    ec->tx_coalesce_usecs > LAN743X_INT_MOD_MAX) {
+		NL_SET_ERR_MSG_FMT_MOD(extack, "maximum is %d usecs",
+				       LAN743X_INT_MOD_MAX);
+		return -EINVAL;
+	}
+
+	adapter->rx_coalesce_usecs = ec->rx_coalesce_usecs;
+	adapter->tx_coalesce_usecs = ec->tx_coalesce_usecs;
+	WRITE_ONCE(adapter->rx_dim_enabled, !!ec->use_adaptive_rx_coalesce);
+	WRITE_ONCE(adapter->tx_dim_enabled, !!ec->use_adaptive_tx_coalesce);
+
+	/* the timers are reprogrammed by lan743x_intr_open otherwise */
+	if (netif_running(netdev))
+		lan743x_intr_set_moderation(adapter);
+
+	return 0;
+}
+
+static void
+lan743x_ethtool_get_ringparam(struct net_device *netdev,
+			      struct ethtool_ringparam *ring,
+			      struct kernel_ethtool_ringparam *kring,
+			      struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	ring->rx_max_pending = LAN743X_RX_RING_SIZE_MAX;
+	ring->tx_max_pending = LAN743X_TX_RING_SIZE_MAX;
+	ring->rx_pending = adapter->rx_ring_size;
+	ring->tx_pending = adapter->tx_ring_size;
+}
+
+static int
+lan743x_ethtool_set_ringparam(struct net_device *netdev,
+			      struct ethtool_ringparam *ring,
+			      struct kernel_ethtool_ringparam *kring,
+			      struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	if (ring->rx_mini_pending || ring->rx_jumbo_pending)
+		return -EINVAL;
+
+	if (ring->rx_pending < LAN743X_RX_RING_SIZE_MIN ||
+	    ring->tx_pending < LAN743X_TX_RING_SIZE_MIN) {
+		NL_SET_ERR_MSG_FMT_MOD(extack,
+				       "minimum ring size is %d rx, %d tx",
+				       LAN743X_RX_RING_SIZE_MIN,
+				       LAN743X_TX_RING_SIZE_MIN);
+		return -EINVAL;
+	}
+
+	if (ring->rx_pending == adapter->rx_ring_size &&
+	    ring->tx_pending == adapter->tx_ring_size)
+		return 0;
+
+	return lan743x_set_ring_size(adapter, ring->rx_pending,
+				     ring->tx_pending);
+}
+
+static int lan743x_ethtool_get_tunable(struct net_device *netdev,
+				       const struct ethtool_tunable *tuna,
+				       void *data)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		*(u32 *)data = adapter->rx_copybreak;
+		return 0;
+	case ETHTOOL_TX_COPYBREAK:
+		*(u32 *)data = adapter->tx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int lan743x_ethtool_set_tunable(struct net_device *netdev,
+				       const struct ethtool_tunable *tuna,
+				       const void *data)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	u32 copybreak;
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		copybreak = *(u32 *)data;
+		if (copybreak > LAN743X_RX_BUF_SIZE - RX_HEAD_PADDING -
+				ETH_FCS_LEN)
+			return -EINVAL;
+		WRITE_ONCE(adapter->rx_copybreak, copybreak);
+		return 0;
+	case ETHTOOL_TX_COPYBREAK:
+		copybreak = *(u32 *)data;
+		if (copybreak > LAN743X_TX_BOUNCE_SIZE)
+			return -EINVAL;
+		WRITE_ONCE(adapter->tx_copybreak, copybreak);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 const struct ethtool_ops lan743x_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.get_drvinfo = lan743x_ethtool_get_drvinfo,
 	.get_msglevel = lan743x_ethtool_get_msglevel,
 	.set_msglevel = lan743x_ethtool_set_msglevel,
@@ -1474,4 +1627,10 @@ const struct ethtool_ops lan743x_ethtool_ops = {
 #endif
 	.self_test = lan743x_ethtool_self_test,
 	.set_tc10 = lan743x_ethtool_set_tc10,
+	.get_coalesce = lan743x_ethtool_get_coalesce,
+	.set_coalesce = lan743x_ethtool_set_coalesce,
+	.get_ringparam = lan743x_ethtool_get_ringparam,
+	.set_ringparam = lan743x_ethtool_set_ringparam,
+	.get_tunable = lan743x_ethtool_get_tunable,
+	.set_tunable = lan743x_ethtool_set_tunable,
 };
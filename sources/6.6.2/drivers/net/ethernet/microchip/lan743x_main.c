@@ -16,6 +16,11 @@
 #include <linux/iopoll.h>
 #include <linux/crc16.h>
 #include <linux/irqdomain.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool/helpers.h>
+#include <net/xdp_sock_drv.h>
+#include <net/netdev_queues.h>
+#include <net/pkt_sched.h>
 #include "lan743x_main.h"
 #include "lan743x_ethtool.h"
 
@@ -487,6 +492,65 @@ static u32 lan743x_intr_get_vector_flags(struct lan743x_adapter *adapter,
 	return 0;
 }
 
+static void lan743x_intr_set_rx_moderation(struct lan743x_adapter *adapter,
+					   int channel, u32 usecs)
+{
+	lan743x_csr_write(adapter, adapter->is_pci11x1x ?
+			  INT_MOD_CFG(PCI11X1X_INT_MOD_RX(channel)) :
+			  INT_MOD_CFG(LAN743X_INT_MOD_RX(channel)), usecs);
+}
+
+static void lan743x_intr_set_tx_moderation(struct lan743x_adapter *adapter,
+					   int channel, u32 usecs)
+{
+	lan743x_csr_write(adapter, adapter->is_pci11x1x ?
+			  INT_MOD_CFG(PCI11X1X_INT_MOD_TX(channel)) :
+			  INT_MOD_CFG(LAN743X_INT_MOD_TX(channel)), usecs);
+}
+
+/* program the static timers, net_dim moves them from there when enabled */
+void lan743x_intr_set_moderation(struct lan743x_adapter *adapter)
+{
+	int index;
+
+	if (adapter->csr.flags & LAN743X_CSR_FLAG_IS_A0)
+		return;
+
+	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++)
+		lan743x_intr_set_rx_moderation(adapter, index,
+					       adapter->rx_coalesce_usecs);
+
+	for (index = 0; index < adapter->used_tx_channels; index++)
+		lan743x_intr_set_tx_moderation(adapter, index,
+					       adapter->tx_coalesce_usecs);
+}
+
+static void lan743x_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct lan743x_rx *rx = container_of(dim, struct lan743x_rx, dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	lan743x_intr_set_rx_moderation(rx->adapter, rx->channel_number,
+				       min_t(u32, moder.usec,
+					     LAN743X_INT_MOD_MAX));
+	dim->state = DIM_START_MEASURE;
+}
+
+static void lan743x_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct lan743x_tx *tx = container_of(dim, struct lan743x_tx, dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	lan743x_intr_set_tx_moderation(tx->adapter, tx->channel_number,
+				       min_t(u32, moder.usec,
+					     LAN743X_INT_MOD_MAX));
+	dim->state = DIM_START_MEASURE;
+}
+
 static void lan743x_intr_close(struct lan743x_adapter *adapter)
 {
 	struct lan743x_intr *intr = &adapter->intr;
@@ -697,6 +761,7 @@ static int lan743x_intr_open(struct lan743x_adapter *adapter)
 			lan743x_csr_write(adapter, INT_MOD_MAP1, 0x00000001);
 		}
 		lan743x_csr_write(adapter, INT_MOD_MAP2, 0x00FFFFFF);
+		lan743x_intr_set_moderation(adapter);
 	}
 
 	/* enable interrupts */
@@ -1866,8 +1931,10 @@ static int lan743x_dmac_rx_wait_till_stopped(struct lan743x_adapter *adapter,
 	return result;
 }
 
+/* budget is the NAPI budget for completions, 0 otherwise */
 static void lan743x_tx_release_desc(struct lan743x_tx *tx,
-				    int descriptor_index, bool cleanup)
+				    int descriptor_index, int budget,
+				    bool cleanup)
 {
 	struct lan743x_tx_buffer_info *buffer_info = NULL;
 	struct lan743x_tx_descriptor *descriptor = NULL;
@@ -1888,7 +1955,13 @@ static void lan743x_tx_release_desc(struct lan743x_tx *tx,
 
 clean_up_data_descriptor:
 	if (buffer_info->dma_ptr) {
-		if (buffer_info->flags &
+		if (buffer_info->flags & (TX_BUFFER_INFO_FLAG_XDP_TX |
+					  TX_BUFFER_INFO_FLAG_XSK |
+					  TX_BUFFER_INFO_FLAG_BOUNCE)) {
+			/* the RX page pool, the XSK pool or the bounce area
+			 * owns the mapping
+			 */
+		} else if (buffer_info->flags &
 		    TX_BUFFER_INFO_FLAG_SKB_FRAGMENT) {
 			dma_unmap_page(&tx->adapter->pdev->dev,
 				       buffer_info->dma_ptr,
@@ -1903,11 +1976,25 @@ clean_up_data_descriptor:
 		buffer_info->dma_ptr = 0;
 		buffer_info->buffer_length = 0;
 	}
+	if (buffer_info->xdpf) {
+		xdp_return_frame(buffer_info->xdpf);
+		goto clear_active;
+	}
+	if (buffer_info->xsk_pool) {
+		xsk_tx_completed(buffer_info->xsk_pool, 1);
+		goto clear_active;
+	}
 	if (!buffer_info->skb)
 		goto clear_active;
 
+	if (!cleanup) {
+		tx->completed_packets++;
+		tx->completed_bytes += buffer_info->skb->len;
+	}
+
 	if (!(buffer_info->flags & TX_BUFFER_INFO_FLAG_TIMESTAMP_REQUESTED)) {
-		dev_kfree_skb_any(buffer_info->skb);
+		/* frees into the per-CPU skb cache from NAPI */
+		napi_consume_skb(buffer_info->skb, budget);
 		goto clear_skb;
 	}
 
@@ -1937,12 +2024,34 @@ static int lan743x_tx_next_index(struct lan743x_tx *tx, int index)
 	return ((++index) % tx->ring_size);
 }
 
-static void lan743x_tx_release_completed_descriptors(struct lan743x_tx *tx)
+/* Runs without tx->ring_lock, only the TX NAPI consumes the ring. The
+ * slots are released before the new head is published to the producers.
+ * At most budget skbs are completed, a budget of 0 (netpoll) completes
+ * all of them. Returns true when completed descriptors are left.
+ */
+static bool lan743x_tx_release_completed_descriptors(struct lan743x_tx *tx,
+						     int budget,
+						     unsigned int *packets,
+						     unsigned int *bytes)
 {
-	while (le32_to_cpu(*tx->head_cpu_ptr) != (tx->last_head)) {
-		lan743x_tx_release_desc(tx, tx->last_head, false);
-		tx->last_head = lan743x_tx_next_index(tx, tx->last_head);
+	u64 completed_packets = tx->completed_packets;
+	u64 completed_bytes = tx->completed_bytes;
+	int hw_head = le32_to_cpu(READ_ONCE(*tx->head_cpu_ptr));
+	int head = tx->last_head;
+
+	while (head != hw_head) {
+		if (budget &&
+		    tx->completed_packets - completed_packets >= budget)
+			break;
+		lan743x_tx_release_desc(tx, head, budget, false);
+		head = lan743x_tx_next_index(tx, head);
 	}
+	smp_store_release(&tx->last_head, head);
+
+	*packets = tx->completed_packets - completed_packets;
+	*bytes = tx->completed_bytes - completed_bytes;
+
+	return head != hw_head;
 }
 
 static void lan743x_tx_release_all_descriptors(struct lan743x_tx *tx)
@@ -1951,7 +2060,7 @@ static void lan743x_tx_release_all_descriptors(struct lan743x_tx *tx)
 
 	original_head = tx->last_head;
 	do {
-		lan743x_tx_release_desc(tx, tx->last_head, true);
+		lan743x_tx_release_desc(tx, tx->last_head, 0, true);
 		tx->last_head = lan743x_tx_next_index(tx, tx->last_head);
 	} while (tx->last_head != original_head);
 	memset(tx->ring_cpu_ptr, 0,
@@ -1975,8 +2084,9 @@ static int lan743x_tx_get_desc_cnt(struct lan743x_tx *tx,
 
 static int lan743x_tx_get_avail_desc(struct lan743x_tx *tx)
 {
-	int last_head = tx->last_head;
-	int last_tail = tx->last_tail;
+	/* pairs with the release in lan743x_tx_release_completed_descriptors */
+	int last_head = smp_load_acquire(&tx->last_head);
+	int last_tail = READ_ONCE(tx->last_tail);
 
 	if (last_tail >= last_head)
 		return tx->ring_size - last_tail + last_head - 1;
@@ -2047,7 +2157,8 @@ static int lan743x_tx_frame_start(struct lan743x_tx *tx,
 				  unsigned int first_buffer_length,
 				  unsigned int frame_length,
 				  bool time_stamp,
-				  bool check_sum)
+				  bool check_sum,
+				  bool bounce)
 {
 	/* called only from within lan743x_tx_xmit_frame.
 	 * assuming tx->ring_lock has already been acquired.
@@ -2064,10 +2175,17 @@ static int lan743x_tx_frame_start(struct lan743x_tx *tx,
 
 	tx_descriptor = &tx->ring_cpu_ptr[tx->frame_tail];
 	buffer_info = &tx->buffer_info[tx->frame_tail];
-	dma_ptr = dma_map_single(dev, first_buffer, first_buffer_length,
-				 DMA_TO_DEVICE);
-	if (dma_mapping_error(dev, dma_ptr))
-		return -ENOMEM;
+	if (bounce) {
+		/* first_buffer is this descriptor's slot of the bounce area */
+		dma_ptr = tx->bounce_dma_ptr +
+			  tx->frame_tail * LAN743X_TX_BOUNCE_SIZE;
+		buffer_info->flags |= TX_BUFFER_INFO_FLAG_BOUNCE;
+	} else {
+		dma_ptr = dma_map_single(dev, first_buffer,
+					 first_buffer_length, DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, dma_ptr))
+			return -ENOMEM;
+	}
 
 	tx_descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(dma_ptr));
 	tx_descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(dma_ptr));
@@ -2172,7 +2290,7 @@ static int lan743x_tx_frame_add_fragment(struct lan743x_tx *tx,
 		/* cleanup all previously setup descriptors */
 		desc_index = tx->frame_first;
 		while (desc_index != tx->frame_tail) {
-			lan743x_tx_release_desc(tx, desc_index, true);
+			lan743x_tx_release_desc(tx, desc_index, 0, true);
 			desc_index = lan743x_tx_next_index(tx, desc_index);
 		}
 		dma_wmb();
@@ -2202,6 +2320,20 @@ static int lan743x_tx_frame_add_fragment(struct lan743x_tx *tx,
 	return 0;
 }
 
+static void lan743x_tx_ring_doorbell(struct lan743x_tx *tx)
+{
+	u32 tx_tail_flags = 0;
+
+	if (tx->vector_flags & LAN743X_VECTOR_FLAG_VECTOR_ENABLE_AUTO_SET)
+		tx_tail_flags |= TX_TAIL_SET_TOP_INT_VEC_EN_;
+	if (tx->vector_flags & LAN743X_VECTOR_FLAG_SOURCE_ENABLE_AUTO_SET)
+		tx_tail_flags |= TX_TAIL_SET_DMAC_INT_EN_ |
+		TX_TAIL_SET_TOP_INT_EN_;
+
+	lan743x_csr_write(tx->adapter, TX_TAIL(tx->channel_number),
+			  tx_tail_flags | tx->last_tail);
+}
+
 static void lan743x_tx_frame_end(struct lan743x_tx *tx,
 				 struct sk_buff *skb,
 				 bool time_stamp,
@@ -2212,8 +2344,6 @@ static void lan743x_tx_frame_end(struct lan743x_tx *tx,
 	 */
 	struct lan743x_tx_descriptor *tx_descriptor = NULL;
 	struct lan743x_tx_buffer_info *buffer_info = NULL;
-	struct lan743x_adapter *adapter = tx->adapter;
-	u32 tx_tail_flags = 0;
 
 	/* wrap up previous descriptor */
 	if ((tx->frame_data0 & TX_DESC_DATA0_DTYPE_MASK_) ==
@@ -2233,17 +2363,6 @@ static void lan743x_tx_frame_end(struct lan743x_tx *tx,
 	tx_descriptor->data0 = cpu_to_le32(tx->frame_data0);
 	tx->frame_tail = lan743x_tx_next_index(tx, tx->frame_tail);
 	tx->last_tail = tx->frame_tail;
-
-	dma_wmb();
-
-	if (tx->vector_flags & LAN743X_VECTOR_FLAG_VECTOR_ENABLE_AUTO_SET)
-		tx_tail_flags |= TX_TAIL_SET_TOP_INT_VEC_EN_;
-	if (tx->vector_flags & LAN743X_VECTOR_FLAG_SOURCE_ENABLE_AUTO_SET)
-		tx_tail_flags |= TX_TAIL_SET_DMAC_INT_EN_ |
-		TX_TAIL_SET_TOP_INT_EN_;
-
-	lan743x_csr_write(adapter, TX_TAIL(tx->channel_number),
-			  tx_tail_flags | tx->frame_tail);
 	tx->frame_flags &= ~TX_FRAME_FLAG_IN_PROGRESS;
 }
 
@@ -2258,8 +2377,9 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 	netdev_tx_t retval = NETDEV_TX_OK;
 	unsigned int frame_length = 0;
 	unsigned int head_length = 0;
-	unsigned long irq_flags = 0;
+	unsigned char *first_buffer;
 	bool do_timestamp = false;
+	bool bounce = false;
 	bool ignore_sync = false;
 	struct netdev_queue *txq;
 	int nr_frags = 0;
@@ -2267,19 +2387,24 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 	int j;
 
 	required_number_of_descriptors = lan743x_tx_get_desc_cnt(tx, skb);
+	txq = netdev_get_tx_queue(netdev, tx->channel_number);
 
-	spin_lock_irqsave(&tx->ring_lock, irq_flags);
+	/* the lock serializes the producers of this channel (xmit, XDP and
+	 * AF_XDP TX), all running with bottom halves disabled. Completion
+	 * runs without it.
+	 */
+	spin_lock(&tx->ring_lock);
 	if (required_number_of_descriptors >
 		lan743x_tx_get_avail_desc(tx)) {
 		if (required_number_of_descriptors > (tx->ring_size - 1)) {
 			dev_kfree_skb_irq(skb);
 		} else {
-			/* save how many descriptors we needed to restart the queue */
-			tx->rqd_descriptors = required_number_of_descriptors;
+			/* XDP frames sharing the ring may have taken the room
+			 * kept for this skb
+			 */
+			netif_txq_try_stop(txq, lan743x_tx_get_avail_desc(tx),
+					   LAN743X_TX_START_THRS);
 			retval = NETDEV_TX_BUSY;
-			txq = netdev_get_tx_queue(tx->adapter->netdev,
-						  tx->channel_number);
-			netif_tx_stop_queue(txq);
 		}
 		goto unlock;
 	}
@@ -2293,6 +2418,7 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 		if (tx->ts_flags & TX_TS_FLAG_ONE_STEP_SYNC)
 			ignore_sync = true;
 	}
+	first_buffer = skb->data;
 	head_length = skb_headlen(skb);
 	frame_length = skb_pagelen(skb);
 	nr_frags = skb_shinfo(skb)->nr_frags;
@@ -2301,6 +2427,18 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 	if (gso) {
 		start_frame_length = max(skb_shinfo(skb)->gso_size,
 					 (unsigned short)8);
+	} else if (skb->len <= READ_ONCE(adapter->tx_copybreak)) {
+		/* small frames skip the DMA mapping, the whole frame goes
+		 * into the slot of its single descriptor
+		 */
+		first_buffer = tx->bounce_cpu_ptr +
+			       tx->last_tail * LAN743X_TX_BOUNCE_SIZE;
+		skb_copy_bits(skb, 0, first_buffer, skb->len);
+		head_length = skb->len;
+		frame_length = skb->len;
+		start_frame_length = skb->len;
+		nr_frags = 0;
+		bounce = true;
 	}
 
 	/* LAN7431 External PHY Timestamping */
@@ -2308,14 +2446,17 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 		skb_tx_timestamp(skb);
 
 	if (lan743x_tx_frame_start(tx,
-				   skb->data, head_length,
+				   first_buffer, head_length,
 				   start_frame_length,
 				   do_timestamp,
-				   skb->ip_summed == CHECKSUM_PARTIAL)) {
+				   skb->ip_summed == CHECKSUM_PARTIAL,
+				   bounce)) {
 		dev_kfree_skb_irq(skb);
 		goto unlock;
 	}
 	tx->frame_count++;
+	if (bounce)
+		tx->bounced_frames++;
 
 	if (gso)
 		lan743x_tx_frame_add_lso(tx, frame_length, nr_frags);
@@ -2339,45 +2480,229 @@ static netdev_tx_t lan743x_tx_xmit_frame(struct lan743x_tx *tx,
 
 finish:
 	lan743x_tx_frame_end(tx, skb, do_timestamp, ignore_sync);
+	/* the hardware doesn't see the frame before the doorbell, so the
+	 * skb is still ours. Count the room left once last_tail has moved
+	 * past it.
+	 */
+	netif_txq_maybe_stop(txq, lan743x_tx_get_avail_desc(tx),
+			     LAN743X_TX_STOP_THRS, LAN743X_TX_START_THRS);
+	/* with more frames coming the tail is written after the last one */
+	if (__netdev_tx_sent_queue(txq, skb->len, netdev_xmit_more())) {
+		dma_wmb();
+		lan743x_tx_ring_doorbell(tx);
+	}
+	spin_unlock(&tx->ring_lock);
+	return retval;
 
 unlock:
-	spin_unlock_irqrestore(&tx->ring_lock, irq_flags);
+	/* the burst ends here, flush frames deferred by xmit_more */
+	dma_wmb();
+	lan743x_tx_ring_doorbell(tx);
+	spin_unlock(&tx->ring_lock);
 	return retval;
 }
 
+static struct lan743x_tx *lan743x_xdp_tx_ring(struct lan743x_adapter *adapter)
+{
+	/* PCI11x1x hands its last channel over to XDP while a program is
+	 * attached, LAN743x shares its only channel with the stack
+	 */
+	return &adapter->tx[adapter->used_tx_channels - 1];
+}
+
+/* called with tx->ring_lock held and at least one free descriptor,
+ * queues a frame held in a single buffer without ringing the doorbell
+ */
+static struct lan743x_tx_buffer_info *
+lan743x_tx_queue_buffer(struct lan743x_tx *tx, dma_addr_t dma_ptr,
+			unsigned int length)
+{
+	struct lan743x_tx_descriptor *tx_descriptor = NULL;
+	struct lan743x_tx_buffer_info *buffer_info = NULL;
+
+	tx_descriptor = &tx->ring_cpu_ptr[tx->last_tail];
+	buffer_info = &tx->buffer_info[tx->last_tail];
+
+	tx_descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(dma_ptr));
+	tx_descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(dma_ptr));
+	tx_descriptor->data3 = cpu_to_le32((length << 16) &
+		TX_DESC_DATA3_FRAME_LENGTH_MSS_MASK_);
+
+	buffer_info->dma_ptr = dma_ptr;
+	buffer_info->buffer_length = length;
+	buffer_info->flags |= TX_BUFFER_INFO_FLAG_ACTIVE;
+
+	tx_descriptor->data0 = cpu_to_le32((length &
+					    TX_DESC_DATA0_BUF_LENGTH_MASK_) |
+					   TX_DESC_DATA0_DTYPE_DATA_ |
+					   TX_DESC_DATA0_FS_ |
+					   TX_DESC_DATA0_LS_ |
+					   TX_DESC_DATA0_FCS_ |
+					   TX_DESC_DATA0_IOC_);
+	tx->last_tail = lan743x_tx_next_index(tx, tx->last_tail);
+	tx->frame_count++;
+
+	return buffer_info;
+}
+
+/* called with tx->ring_lock held, the tail is written by
+ * lan743x_tx_xdp_flush
+ */
+static int lan743x_tx_xdp_frame(struct lan743x_tx *tx,
+				struct xdp_frame *xdpf, bool dma_map)
+{
+	struct lan743x_tx_buffer_info *buffer_info = NULL;
+	struct device *dev = &tx->adapter->pdev->dev;
+	struct page *page;
+	dma_addr_t dma_ptr;
+
+	if (lan743x_tx_get_avail_desc(tx) < 1)
+		return -ENOSPC;
+
+	if (dma_map) {
+		dma_ptr = dma_map_single(dev, xdpf->data, xdpf->len,
+					 DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, dma_ptr))
+			return -ENOMEM;
+	} else {
+		/* XDP_TX: the page pool keeps its pages mapped both ways */
+		page = virt_to_page(xdpf->data);
+		dma_ptr = page_pool_get_dma_addr(page) +
+			  (xdpf->data - page_address(page));
+		dma_sync_single_for_device(dev, dma_ptr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	buffer_info = lan743x_tx_queue_buffer(tx, dma_ptr, xdpf->len);
+	buffer_info->xdpf = xdpf;
+	if (!dma_map)
+		buffer_info->flags |= TX_BUFFER_INFO_FLAG_XDP_TX;
+
+	return 0;
+}
+
+/* called with tx->ring_lock held */
+static void lan743x_tx_xdp_flush(struct lan743x_tx *tx)
+{
+	dma_wmb();
+	lan743x_tx_ring_doorbell(tx);
+}
+
+/* Returns -EOVERFLOW when @xdp could not be converted and still belongs to
+ * the caller. On any other error the frame has already been released.
+ */
+static int lan743x_tx_xdp_xmit_back(struct lan743x_adapter *adapter,
+				    struct xdp_buff *xdp)
+{
+	struct lan743x_tx *tx = lan743x_xdp_tx_ring(adapter);
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	int ret;
+
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	/* zero-copy buffers are copied into a fresh page by the conversion */
+	spin_lock(&tx->ring_lock);
+	ret = lan743x_tx_xdp_frame(tx, xdpf,
+				   xdpf->mem.type != MEM_TYPE_PAGE_POOL);
+	spin_unlock(&tx->ring_lock);
+
+	/* for zero-copy buffers the conversion already freed the XSK
+	 * buffer, only the frame is left to release
+	 */
+	if (ret)
+		xdp_return_frame_rx_napi(xdpf);
+
+	return ret;
+}
+
+/* send up to budget AF_XDP frames, returns true when some are left */
+static bool lan743x_tx_xsk_xmit(struct lan743x_tx *tx,
+				struct xsk_buff_pool *pool, int budget)
+{
+	struct lan743x_tx_buffer_info *buffer_info = NULL;
+	struct xdp_desc desc;
+	dma_addr_t dma_ptr;
+	int sent = 0;
+
+	spin_lock(&tx->ring_lock);
+	while (sent < budget && lan743x_tx_get_avail_desc(tx) > 0 &&
+	       xsk_tx_peek_desc(pool, &desc)) {
+		dma_ptr = xsk_buff_raw_get_dma(pool, desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma_ptr, desc.len);
+
+		buffer_info = lan743x_tx_queue_buffer(tx, dma_ptr, desc.len);
+		buffer_info->xsk_pool = pool;
+		buffer_info->flags |= TX_BUFFER_INFO_FLAG_XSK;
+		sent++;
+	}
+	if (sent) {
+		lan743x_tx_xdp_flush(tx);
+		xsk_tx_release(pool);
+	}
+	spin_unlock(&tx->ring_lock);
+
+	if (xsk_uses_need_wakeup(pool))
+		xsk_set_tx_need_wakeup(pool);
+
+	return sent == budget;
+}
+
 static int lan743x_tx_napi_poll(struct napi_struct *napi, int weight)
 {
 	struct lan743x_tx *tx = container_of(napi, struct lan743x_tx, napi);
 	struct lan743x_adapter *adapter = tx->adapter;
-	unsigned long irq_flags = 0;
+	struct xsk_buff_pool *xsk_pool;
+	unsigned int packets, bytes;
 	struct netdev_queue *txq;
+	bool xsk_busy = false;
+	bool tx_busy;
 	u32 ioc_bit = 0;
+	int index;
 
 	ioc_bit = DMAC_INT_BIT_TX_IOC_(tx->channel_number);
 	lan743x_csr_read(adapter, DMAC_INT_STS);
 	if (tx->vector_flags & LAN743X_VECTOR_FLAG_SOURCE_STATUS_W2C)
 		lan743x_csr_write(adapter, DMAC_INT_STS, ioc_bit);
-	spin_lock_irqsave(&tx->ring_lock, irq_flags);
 
 	/* clean up tx ring */
-	lan743x_tx_release_completed_descriptors(tx);
+	tx_busy = lan743x_tx_release_completed_descriptors(tx, weight,
+							   &packets, &bytes);
 	txq = netdev_get_tx_queue(adapter->netdev, tx->channel_number);
-	if (netif_tx_queue_stopped(txq)) {
-		if (tx->rqd_descriptors) {
-			if (tx->rqd_descriptors <=
-			    lan743x_tx_get_avail_desc(tx)) {
-				tx->rqd_descriptors = 0;
-				netif_tx_wake_queue(txq);
-			}
-		} else {
-			netif_tx_wake_queue(txq);
+	netif_txq_completed_wake(txq, packets, bytes,
+				 lan743x_tx_get_avail_desc(tx),
+				 LAN743X_TX_START_THRS);
+
+	/* AF_XDP sockets of every queue transmit on the XDP channel */
+	if (tx == lan743x_xdp_tx_ring(adapter) &&
+	    READ_ONCE(adapter->xdp_prog)) {
+		for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++) {
+			xsk_pool = READ_ONCE(adapter->rx[index].xsk_pool);
+			if (xsk_pool)
+				xsk_busy |= lan743x_tx_xsk_xmit(tx, xsk_pool,
+								weight);
 		}
+		if (xsk_busy)
+			return weight;
 	}
-	spin_unlock_irqrestore(&tx->ring_lock, irq_flags);
+
+	/* leave the rest of a completion burst to the next poll so RX
+	 * processing on this CPU is not starved
+	 */
+	if (tx_busy)
+		return weight;
 
 	if (!napi_complete(napi))
 		goto done;
 
+	if (READ_ONCE(adapter->tx_dim_enabled)) {
+		struct dim_sample sample = {};
+
+		dim_update_sample(++tx->dim_events, tx->completed_packets,
+				  tx->completed_bytes, &sample);
+		net_dim(&tx->dim, sample);
+	}
+
 	/* enable isr */
 	lan743x_csr_write(adapter, INT_EN_SET,
 			  INT_BIT_DMA_TX_(tx->channel_number));
@@ -2407,6 +2732,14 @@ static void lan743x_tx_ring_cleanup(struct lan743x_tx *tx)
 		tx->ring_cpu_ptr = NULL;
 		tx->ring_dma_ptr = 0;
 	}
+
+	if (tx->bounce_cpu_ptr) {
+		dma_free_coherent(&tx->adapter->pdev->dev,
+				  tx->ring_size * LAN743X_TX_BOUNCE_SIZE,
+				  tx->bounce_cpu_ptr, tx->bounce_dma_ptr);
+		tx->bounce_cpu_ptr = NULL;
+		tx->bounce_dma_ptr = 0;
+	}
 	tx->ring_size = 0;
 }
 
@@ -2417,7 +2750,7 @@ static int lan743x_tx_ring_init(struct lan743x_tx *tx)
 	dma_addr_t dma_ptr;
 	int ret = -ENOMEM;
 
-	tx->ring_size = LAN743X_TX_RING_SIZE;
+	tx->ring_size = tx->adapter->tx_ring_size;
 	if (tx->ring_size & ~TX_CFG_B_TX_RING_LEN_MASK_) {
 		ret = -EINVAL;
 		goto cleanup;
@@ -2466,6 +2799,17 @@ static int lan743x_tx_ring_init(struct lan743x_tx *tx)
 		goto cleanup;
 	}
 
+	dma_ptr = 0;
+	cpu_ptr = dma_alloc_coherent(&tx->adapter->pdev->dev,
+				     tx->ring_size * LAN743X_TX_BOUNCE_SIZE,
+				     &dma_ptr, GFP_KERNEL);
+	if (!cpu_ptr) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+	tx->bounce_cpu_ptr = cpu_ptr;
+	tx->bounce_dma_ptr = dma_ptr;
+
 	return 0;
 
 cleanup:
@@ -2489,6 +2833,7 @@ static void lan743x_tx_close(struct lan743x_tx *tx)
 			  INT_BIT_DMA_TX_(tx->channel_number));
 	napi_disable(&tx->napi);
 	netif_napi_del(&tx->napi);
+	cancel_work_sync(&tx->dim.work);
 
 	lan743x_csr_write(adapter, FCT_TX_CTL,
 			  FCT_TX_CTL_DIS_(tx->channel_number));
@@ -2498,11 +2843,50 @@ static void lan743x_tx_close(struct lan743x_tx *tx)
 
 	lan743x_tx_release_all_descriptors(tx);
 
-	tx->rqd_descriptors = 0;
-
 	lan743x_tx_ring_cleanup(tx);
 }
 
+/* spread the CPUs evenly over the TX queues the stack uses, once per
+ * queue so that a reopen doesn't overwrite maps set through sysfs
+ */
+static void lan743x_tx_set_xps(struct lan743x_tx *tx)
+{
+	struct net_device *netdev = tx->adapter->netdev;
+	cpumask_var_t mask;
+	int cpu;
+
+	if (tx->xps_init_done ||
+	    tx->channel_number >= netdev->real_num_tx_queues)
+		return;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		if (cpu % netdev->real_num_tx_queues == tx->channel_number)
+			cpumask_set_cpu(cpu, mask);
+	}
+	if (!netif_set_xps_queue(netdev, mask, tx->channel_number))
+		tx->xps_init_done = true;
+	free_cpumask_var(mask);
+}
+
+/* Changing the real queue count or the tc layout makes the core drop XPS
+ * maps, put the defaults back for the new layout
+ */
+static void lan743x_tx_reset_xps(struct lan743x_adapter *adapter)
+{
+	int index;
+
+	if (!adapter->is_pci11x1x)
+		return;
+
+	for (index = 0; index < adapter->used_tx_channels; index++) {
+		adapter->tx[index].xps_init_done = false;
+		lan743x_tx_set_xps(&adapter->tx[index]);
+	}
+}
+
 static int lan743x_tx_open(struct lan743x_tx *tx)
 {
 	struct lan743x_adapter *adapter = NULL;
@@ -2579,6 +2963,13 @@ static int lan743x_tx_open(struct lan743x_tx *tx)
 	netif_napi_add_tx_weight(adapter->netdev,
 				 &tx->napi, lan743x_tx_napi_poll,
 				 NAPI_POLL_WEIGHT);
+	memset(&tx->dim, 0, sizeof(tx->dim));
+	INIT_WORK(&tx->dim.work, lan743x_tx_dim_work);
+	tx->dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+	netdev_tx_reset_queue(netdev_get_tx_queue(adapter->netdev,
+						  tx->channel_number));
+	if (adapter->is_pci11x1x)
+		lan743x_tx_set_xps(tx);
 	napi_enable(&tx->napi);
 
 	data = 0;
@@ -2609,86 +3000,106 @@ static int lan743x_rx_next_index(struct lan743x_rx *rx, int index)
 	return ((++index) % rx->ring_size);
 }
 
-static void lan743x_rx_update_tail(struct lan743x_rx *rx, int index)
-{
-	/* update the tail once per 8 descriptors */
-	if ((index & 7) == 7)
-		lan743x_csr_write(rx->adapter, RX_TAIL(rx->channel_number),
-				  index);
-}
-
-static int lan743x_rx_init_ring_element(struct lan743x_rx *rx, int index,
-					gfp_t gfp)
+static void lan743x_rx_reuse_ring_element(struct lan743x_rx *rx, int index)
 {
-	struct net_device *netdev = rx->adapter->netdev;
-	struct device *dev = &rx->adapter->pdev->dev;
 	struct lan743x_rx_buffer_info *buffer_info;
-	unsigned int buffer_length, used_length;
 	struct lan743x_rx_descriptor *descriptor;
-	struct sk_buff *skb;
-	dma_addr_t dma_ptr;
-
-	buffer_length = netdev->mtu + ETH_HLEN + ETH_FCS_LEN + RX_HEAD_PADDING;
 
 	descriptor = &rx->ring_cpu_ptr[index];
 	buffer_info = &rx->buffer_info[index];
-	skb = __netdev_alloc_skb(netdev, buffer_length, gfp);
-	if (!skb)
-		return -ENOMEM;
-	dma_ptr = dma_map_single(dev, skb->data, buffer_length, DMA_FROM_DEVICE);
-	if (dma_mapping_error(dev, dma_ptr)) {
-		dev_kfree_skb_any(skb);
-		return -ENOMEM;
-	}
-	if (buffer_info->dma_ptr) {
-		/* sync used area of buffer only */
-		if (le32_to_cpu(descriptor->data0) & RX_DESC_DATA0_LS_)
-			/* frame length is valid only if LS bit is set.
-			 * it's a safe upper bound for the used area in this
-			 * buffer.
-			 */
-			used_length = min(RX_DESC_DATA0_FRAME_LENGTH_GET_
-					  (le32_to_cpu(descriptor->data0)),
-					  buffer_info->buffer_length);
-		else
-			used_length = buffer_info->buffer_length;
-		dma_sync_single_for_cpu(dev, buffer_info->dma_ptr,
-					used_length,
-					DMA_FROM_DEVICE);
-		dma_unmap_single_attrs(dev, buffer_info->dma_ptr,
-				       buffer_info->buffer_length,
-				       DMA_FROM_DEVICE,
-				       DMA_ATTR_SKIP_CPU_SYNC);
-	}
 
-	buffer_info->skb = skb;
-	buffer_info->dma_ptr = dma_ptr;
-	buffer_info->buffer_length = buffer_length;
 	descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(buffer_info->dma_ptr));
 	descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(buffer_info->dma_ptr));
 	descriptor->data3 = 0;
 	descriptor->data0 = cpu_to_le32((RX_DESC_DATA0_OWN_ |
-			    (buffer_length & RX_DESC_DATA0_BUF_LENGTH_MASK_)));
-	lan743x_rx_update_tail(rx, index);
-
-	return 0;
+			    ((buffer_info->buffer_length) &
+			    RX_DESC_DATA0_BUF_LENGTH_MASK_)));
 }
 
-static void lan743x_rx_reuse_ring_element(struct lan743x_rx *rx, int index)
+static int lan743x_rx_init_ring_element(struct lan743x_rx *rx, int index,
+					gfp_t gfp)
 {
 	struct lan743x_rx_buffer_info *buffer_info;
-	struct lan743x_rx_descriptor *descriptor;
+	struct xdp_buff *xdp;
+	struct page *page;
 
-	descriptor = &rx->ring_cpu_ptr[index];
 	buffer_info = &rx->buffer_info[index];
+	if (rx->xsk_pool) {
+		/* an empty fill ring must not stall the ring, fall back to
+		 * the scratch buffer until user space provides frames
+		 */
+		xdp = buffer_info->xsk_buff;
+		if (!xdp)
+			xdp = xsk_buff_alloc(rx->xsk_pool);
+		if (xsk_uses_need_wakeup(rx->xsk_pool)) {
+			if (xdp)
+				xsk_clear_rx_need_wakeup(rx->xsk_pool);
+			else
+				xsk_set_rx_need_wakeup(rx->xsk_pool);
+		}
+		buffer_info->xsk_buff = xdp;
+		buffer_info->dma_ptr = xdp ? xsk_buff_xdp_get_dma(xdp) :
+				       rx->xsk_scratch_dma_ptr;
+		buffer_info->buffer_length =
+			min_t(u32, xsk_pool_get_rx_frame_size(rx->xsk_pool),
+			      RX_DESC_DATA0_BUF_LENGTH_MASK_);
+		lan743x_rx_reuse_ring_element(rx, index);
 
-	descriptor->data1 = cpu_to_le32(DMA_ADDR_LOW32(buffer_info->dma_ptr));
-	descriptor->data2 = cpu_to_le32(DMA_ADDR_HIGH32(buffer_info->dma_ptr));
-	descriptor->data3 = 0;
-	descriptor->data0 = cpu_to_le32((RX_DESC_DATA0_OWN_ |
-			    ((buffer_info->buffer_length) &
-			    RX_DESC_DATA0_BUF_LENGTH_MASK_)));
-	lan743x_rx_update_tail(rx, index);
+		return 0;
+	}
+
+	/* a page left on the ring, e.g. by copybreak, is posted again */
+	if (!buffer_info->page) {
+		page = page_pool_alloc_pages(rx->page_pool, gfp);
+		if (!page)
+			return -ENOMEM;
+
+		buffer_info->page = page;
+		buffer_info->dma_ptr = page_pool_get_dma_addr(page) +
+				       LAN743X_RX_HEADROOM;
+		buffer_info->buffer_length = LAN743X_RX_BUF_SIZE;
+	}
+	lan743x_rx_reuse_ring_element(rx, index);
+
+	return 0;
+}
+
+/* Hand the descriptors consumed since the last refill back to the DMAC
+ * with a single tail write. Unless forced, wait until a batch of them is
+ * pending. Returns false when a page could not be allocated, the refill
+ * is then retried on the next poll.
+ */
+static bool lan743x_rx_refill(struct lan743x_rx *rx, bool force)
+{
+	int pending = ((int)rx->last_head - (int)rx->last_tail - 1 +
+		       rx->ring_size) % rx->ring_size;
+	u32 last_tail = rx->last_tail;
+	bool refilled = true;
+	int index;
+
+	if (!pending || (!force &&
+			 pending < min_t(int, LAN743X_RX_REFILL_BATCH,
+					 rx->ring_size / 2)))
+		return true;
+
+	/* page_pool refills its cache from the page allocator in bulk */
+	for (; pending; pending--) {
+		index = lan743x_rx_next_index(rx, rx->last_tail);
+		if (lan743x_rx_init_ring_element(rx, index, GFP_ATOMIC)) {
+			refilled = false;
+			break;
+		}
+		rx->last_tail = index;
+	}
+
+	if (rx->last_tail != last_tail) {
+		/* descriptors must be visible before the DMAC fetches them */
+		dma_wmb();
+		lan743x_csr_write(rx->adapter, RX_TAIL(rx->channel_number),
+				  rx->last_tail);
+	}
+
+	return refilled;
 }
 
 static void lan743x_rx_release_ring_element(struct lan743x_rx *rx, int index)
@@ -2701,18 +3112,11 @@ static void lan743x_rx_release_ring_element(struct lan743x_rx *rx, int index)
 
 	memset(descriptor, 0, sizeof(*descriptor));
 
-	if (buffer_info->dma_ptr) {
-		dma_unmap_single(&rx->adapter->pdev->dev,
-				 buffer_info->dma_ptr,
-				 buffer_info->buffer_length,
-				 DMA_FROM_DEVICE);
-		buffer_info->dma_ptr = 0;
-	}
-
-	if (buffer_info->skb) {
-		dev_kfree_skb(buffer_info->skb);
-		buffer_info->skb = NULL;
-	}
+	/* the page pool keeps the page mapped, just hand it back */
+	if (buffer_info->page)
+		page_pool_put_full_page(rx->page_pool, buffer_info->page, false);
+	if (buffer_info->xsk_buff)
+		xsk_buff_free(buffer_info->xsk_buff);
 
 	memset(buffer_info, 0, sizeof(*buffer_info));
 }
@@ -2720,41 +3124,170 @@ static void lan743x_rx_release_ring_element(struct lan743x_rx *rx, int index)
 static struct sk_buff *
 lan743x_rx_trim_skb(struct sk_buff *skb, int frame_length)
 {
-	if (skb_linearize(skb)) {
+	/* drops surplus page frags without touching the payload */
+	frame_length = max_t(int, 0, frame_length - ETH_FCS_LEN);
+	if (skb->len > frame_length && pskb_trim(skb, frame_length)) {
 		dev_kfree_skb_irq(skb);
 		return NULL;
 	}
-	frame_length = max_t(int, 0, frame_length - ETH_FCS_LEN);
-	if (skb->len > frame_length) {
-		skb->tail -= skb->len - frame_length;
-		skb->len = frame_length;
-	}
 	return skb;
 }
 
-static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
+/* copy a small frame out of its page, the page stays on the ring */
+static struct sk_buff *lan743x_rx_copybreak(struct lan743x_rx *rx,
+					    struct page *page,
+					    dma_addr_t dma_ptr,
+					    int frame_length)
 {
-	int current_head_index = le32_to_cpu(*rx->head_cpu_ptr);
-	struct lan743x_rx_descriptor *descriptor, *desc_ext;
-	struct net_device *netdev = rx->adapter->netdev;
-	int result = RX_PROCESS_RESULT_NOTHING_TO_DO;
-	struct lan743x_rx_buffer_info *buffer_info;
-	int frame_length, buffer_length;
-	bool is_ice, is_tce, is_icsm;
-	int extension_index = -1;
-	bool is_last, is_first;
+	enum dma_data_direction dir = page_pool_get_dma_dir(rx->page_pool);
+	unsigned int len = frame_length - ETH_FCS_LEN;
+	struct device *dev = &rx->adapter->pdev->dev;
+	unsigned int sync_len = RX_HEAD_PADDING + frame_length;
 	struct sk_buff *skb;
 
-	if (current_head_index < 0 || current_head_index >= rx->ring_size)
-		goto done;
-
-	if (rx->last_head < 0 || rx->last_head >= rx->ring_size)
-		goto done;
+	dma_sync_single_for_cpu(dev, dma_ptr, sync_len, dir);
+	skb = napi_alloc_skb(&rx->napi, len);
+	if (skb)
+		skb_put_data(skb, page_address(page) + LAN743X_RX_HEADROOM +
+			     RX_HEAD_PADDING, len);
+	dma_sync_single_for_device(dev, dma_ptr, sync_len, dir);
 
-	if (rx->last_head == current_head_index)
-		goto done;
+	return skb;
+}
 
-	descriptor = &rx->ring_cpu_ptr[rx->last_head];
+static u32 lan743x_rx_run_xdp(struct lan743x_rx *rx, struct bpf_prog *prog,
+			      struct xdp_buff *xdp)
+{
+	struct net_device *netdev = rx->adapter->netdev;
+	u32 act;
+	int ret;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return act;
+	case XDP_TX:
+		/* the XDP TX channel may be restarting under this ring */
+		if (!READ_ONCE(rx->adapter->xdp_tx_ready))
+			goto out_failure;
+		ret = lan743x_tx_xdp_xmit_back(rx->adapter, xdp);
+		if (ret == -EOVERFLOW)
+			goto out_failure;
+		if (ret) {
+			trace_xdp_exception(netdev, prog, act);
+			return XDP_DROP;
+		}
+		rx->xdp_flush |= LAN743X_XDP_FLUSH_TX;
+		return act;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(netdev, xdp, prog))
+			goto out_failure;
+		rx->xdp_flush |= LAN743X_XDP_FLUSH_REDIRECT;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(netdev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(netdev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		xdp_return_buff(xdp);
+		return XDP_DROP;
+	}
+}
+
+/* AF_XDP zero-copy receive of the buffer at last_head. The frame stays in
+ * UMEM unless the program passes it to the stack, then it is copied.
+ */
+static struct sk_buff *lan743x_rx_xsk_buffer(struct lan743x_rx *rx,
+					     bool is_single, int frame_length)
+{
+	struct lan743x_rx_buffer_info *buffer_info;
+	struct bpf_prog *xdp_prog;
+	struct sk_buff *skb;
+	struct xdp_buff *xdp;
+	unsigned int len;
+
+	/* the slot is refilled from the fill ring by lan743x_rx_refill */
+	buffer_info = &rx->buffer_info[rx->last_head];
+	xdp = buffer_info->xsk_buff;
+	buffer_info->xsk_buff = NULL;
+
+	/* frame landed in the scratch buffer */
+	if (!xdp)
+		return NULL;
+
+	/* frames spanning several UMEM frames are not supported */
+	if (!is_single || frame_length < ETH_FCS_LEN) {
+		xsk_buff_free(xdp);
+		return NULL;
+	}
+
+	len = frame_length - ETH_FCS_LEN;
+	xsk_buff_set_size(xdp, RX_HEAD_PADDING + len);
+	xdp->data += RX_HEAD_PADDING;
+	xdp->data_meta = xdp->data;
+	xsk_buff_dma_sync_for_cpu(xdp, rx->xsk_pool);
+
+	xdp_prog = READ_ONCE(rx->adapter->xdp_prog);
+	if (xdp_prog && lan743x_rx_run_xdp(rx, xdp_prog, xdp) != XDP_PASS)
+		return NULL;
+
+	len = xdp->data_end - xdp->data;
+	skb = napi_alloc_skb(&rx->napi, len);
+	if (skb)
+		skb_put_data(skb, xdp->data, len);
+	xsk_buff_free(xdp);
+
+	return skb;
+}
+
+static void lan743x_rx_xdp_flush(struct lan743x_rx *rx)
+{
+	struct lan743x_tx *tx = lan743x_xdp_tx_ring(rx->adapter);
+
+	if (rx->xdp_flush & LAN743X_XDP_FLUSH_TX) {
+		spin_lock(&tx->ring_lock);
+		lan743x_tx_xdp_flush(tx);
+		spin_unlock(&tx->ring_lock);
+	}
+
+	if (rx->xdp_flush & LAN743X_XDP_FLUSH_REDIRECT)
+		xdp_do_flush();
+
+	rx->xdp_flush = 0;
+}
+
+static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
+{
+	int current_head_index = le32_to_cpu(*rx->head_cpu_ptr);
+	struct lan743x_rx_descriptor *descriptor, *desc_ext;
+	struct net_device *netdev = rx->adapter->netdev;
+	struct device *dev = &rx->adapter->pdev->dev;
+	int result = RX_PROCESS_RESULT_NOTHING_TO_DO;
+	struct lan743x_rx_buffer_info *buffer_info;
+	int frame_length, buffer_length;
+	bool is_ice, is_tce, is_icsm;
+	int extension_index = -1;
+	struct bpf_prog *xdp_prog;
+	bool is_last, is_first;
+	bool xdp_pass = false;
+	struct xdp_buff xdp;
+	dma_addr_t dma_ptr;
+	struct sk_buff *skb;
+	struct page *page;
+
+	if (current_head_index < 0 || current_head_index >= rx->ring_size)
+		goto done;
+
+	if (rx->last_head < 0 || rx->last_head >= rx->ring_size)
+		goto done;
+
+	if (rx->last_head == current_head_index)
+		goto done;
+
+	descriptor = &rx->ring_cpu_ptr[rx->last_head];
 	if (le32_to_cpu(descriptor->data0) & RX_DESC_DATA0_OWN_)
 		goto done;
 	buffer_info = &rx->buffer_info[rx->last_head];
@@ -2796,44 +3329,113 @@ static int lan743x_rx_process_buffer(struct lan743x_rx *rx)
 		   is_last  ? "last  " : "      ",
 		   frame_length, buffer_length);
 
-	/* save existing skb, allocate new skb and map to dma */
-	skb = buffer_info->skb;
-	if (lan743x_rx_init_ring_element(rx, rx->last_head,
-					 GFP_ATOMIC | GFP_DMA)) {
-		/* failed to allocate next skb.
-		 * Memory is very low.
-		 * Drop this packet and reuse buffer.
-		 */
-		lan743x_rx_reuse_ring_element(rx, rx->last_head);
-		/* drop packet that was being assembled */
+	xdp_prog = READ_ONCE(rx->adapter->xdp_prog);
+	if (is_first && !is_last && (xdp_prog || rx->xsk_pool))
+		rx->xdp_multi_buf_drops++;
+
+	if (rx->xsk_pool) {
+		skb = lan743x_rx_xsk_buffer(rx, is_first && is_last,
+					    frame_length);
+		dev_kfree_skb_irq(rx->skb_head);
+		rx->skb_head = skb;
+		/* the program may have moved the frame boundaries */
+		if (skb)
+			frame_length = skb->len + ETH_FCS_LEN;
+		goto process_extension;
+	}
+
+	/* take the page, lan743x_rx_refill posts a new one in its place */
+	page = buffer_info->page;
+	dma_ptr = buffer_info->dma_ptr;
+
+	if (!xdp_prog && is_first && is_last && frame_length > ETH_FCS_LEN &&
+	    frame_length - ETH_FCS_LEN <=
+	    (int)READ_ONCE(rx->adapter->rx_copybreak)) {
+		skb = lan743x_rx_copybreak(rx, page, dma_ptr, frame_length);
+		dev_kfree_skb_irq(rx->skb_head);
+		rx->skb_head = skb;
+		goto process_extension;
+	}
+	buffer_info->page = NULL;
+
+	/* the program can't see a frame spread over several buffers, so
+	 * it must not reach the stack unfiltered either
+	 */
+	if (xdp_prog && !(is_first && is_last)) {
+		page_pool_recycle_direct(rx->page_pool, page);
 		dev_kfree_skb_irq(rx->skb_head);
 		rx->skb_head = NULL;
 		goto process_extension;
 	}
 
-	/* add buffers to skb via skb->frag_list */
-	if (is_first) {
-		skb_reserve(skb, RX_HEAD_PADDING);
-		skb_put(skb, buffer_length - RX_HEAD_PADDING);
+	/* frame length is valid only if LS bit is set, it's a safe upper
+	 * bound for the used area in this buffer
+	 */
+	dma_sync_single_for_cpu(dev, dma_ptr,
+				is_last ? min(frame_length, buffer_length) :
+				buffer_length,
+				page_pool_get_dma_dir(rx->page_pool));
+
+	if (xdp_prog) {
+		xdp_init_buff(&xdp, PAGE_SIZE, &rx->xdp_rxq);
+		xdp_prepare_buff(&xdp, page_address(page),
+				 LAN743X_RX_HEADROOM + RX_HEAD_PADDING,
+				 max_t(int, 0, frame_length - ETH_FCS_LEN),
+				 true);
+		if (lan743x_rx_run_xdp(rx, xdp_prog, &xdp) != XDP_PASS) {
+			dev_kfree_skb_irq(rx->skb_head);
+			rx->skb_head = NULL;
+			goto process_extension;
+		}
+		xdp_pass = true;
+	}
+
+	/* later buffers of a frame are attached to the head as page frags */
+	if (!is_first) {
+		if (rx->skb_head &&
+		    skb_shinfo(rx->skb_head)->nr_frags < MAX_SKB_FRAGS) {
+			skb_add_rx_frag(rx->skb_head,
+					skb_shinfo(rx->skb_head)->nr_frags,
+					page, LAN743X_RX_HEADROOM,
+					buffer_length, PAGE_SIZE);
+		} else {
+			/* packet to assemble has already been dropped or
+			 * has more buffers than an skb can hold
+			 */
+			netdev_dbg(netdev,
+				   "drop buffer intended for dropped packet");
+			page_pool_recycle_direct(rx->page_pool, page);
+			dev_kfree_skb_irq(rx->skb_head);
+			rx->skb_head = NULL;
+		}
+		goto process_extension;
+	}
+
+	skb = napi_build_skb(page_address(page), PAGE_SIZE);
+	if (!skb) {
+		page_pool_recycle_direct(rx->page_pool, page);
+		dev_kfree_skb_irq(rx->skb_head);
+		rx->skb_head = NULL;
+		goto process_extension;
+	}
+	skb_mark_for_recycle(skb);
+
+	if (xdp_pass) {
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		skb_put(skb, xdp.data_end - xdp.data);
+		if (xdp.data_meta != xdp.data)
+			skb_metadata_set(skb, xdp.data - xdp.data_meta);
+		/* the program may have moved the frame boundaries */
+		frame_length = skb->len + ETH_FCS_LEN;
 		if (rx->skb_head)
 			dev_kfree_skb_irq(rx->skb_head);
 		rx->skb_head = skb;
-	} else if (rx->skb_head) {
-		skb_put(skb, buffer_length);
-		if (skb_shinfo(rx->skb_head)->frag_list)
-			rx->skb_tail->next = skb;
-		else
-			skb_shinfo(rx->skb_head)->frag_list = skb;
-		rx->skb_tail = skb;
-		rx->skb_head->len += skb->len;
-		rx->skb_head->data_len += skb->len;
-		rx->skb_head->truesize += skb->truesize;
 	} else {
-		/* packet to assemble has already been dropped because one or
-		 * more of its buffers could not be allocated
-		 */
-		netdev_dbg(netdev, "drop buffer intended for dropped packet");
-		dev_kfree_skb_irq(skb);
+		skb_reserve(skb, LAN743X_RX_HEADROOM + RX_HEAD_PADDING);
+		skb_put(skb, buffer_length - RX_HEAD_PADDING);
+		if (rx->skb_head)
+			dev_kfree_skb_irq(rx->skb_head);
+		rx->skb_head = skb;
 	}
 
 process_extension:
@@ -2847,7 +3449,6 @@ process_extension:
 		if (rx->skb_head)
 			skb_hwtstamps(rx->skb_head)->hwtstamp =
 				ktime_set(ts_sec, ts_nsec);
-		lan743x_rx_reuse_ring_element(rx, extension_index);
 		rx->last_head = extension_index;
 		netdev_dbg(netdev, "process extension");
 	}
@@ -2860,17 +3461,18 @@ process_extension:
 							rx->adapter->netdev);
 		if (rx->adapter->netdev->features & NETIF_F_RXCSUM) {
 			if (!is_ice && !is_tce && !is_icsm)
-				skb->ip_summed = CHECKSUM_UNNECESSARY;
+				rx->skb_head->ip_summed = CHECKSUM_UNNECESSARY;
 		}
 		netdev_dbg(netdev, "sending %d byte frame to OS",
 			   rx->skb_head->len);
+		rx->dim_packets++;
+		rx->dim_bytes += rx->skb_head->len;
 		napi_gro_receive(&rx->napi, rx->skb_head);
 		rx->skb_head = NULL;
 	}
 
 move_forward:
-	/* push tail and head forward */
-	rx->last_tail = rx->last_head;
+	/* push head forward, the tail follows in lan743x_rx_refill */
 	rx->last_head = lan743x_rx_next_index(rx, rx->last_head);
 	result = RX_PROCESS_RESULT_BUFFER_RECEIVED;
 done:
@@ -2896,12 +3498,24 @@ static int lan743x_rx_napi_poll(struct napi_struct *napi, int weight)
 			break;
 	}
 	rx->frame_count += count;
-	if (count == weight || result == RX_PROCESS_RESULT_BUFFER_RECEIVED)
+	if (rx->xdp_flush)
+		lan743x_rx_xdp_flush(rx);
+	/* keep polling while pages are short, no interrupt may come */
+	if (!lan743x_rx_refill(rx, count < weight) || count == weight ||
+	    result == RX_PROCESS_RESULT_BUFFER_RECEIVED)
 		return weight;
 
 	if (!napi_complete_done(napi, count))
 		return count;
 
+	if (READ_ONCE(adapter->rx_dim_enabled)) {
+		struct dim_sample sample = {};
+
+		dim_update_sample(++rx->dim_events, rx->dim_packets,
+				  rx->dim_bytes, &sample);
+		net_dim(&rx->dim, sample);
+	}
+
 	/* re-arm interrupts, must write to rx tail on some chip variants */
 	if (rx->vector_flags & LAN743X_VECTOR_FLAG_VECTOR_ENABLE_AUTO_SET)
 		rx_tail_flags |= RX_TAIL_SET_TOP_INT_VEC_EN_;
@@ -2939,6 +3553,17 @@ static void lan743x_rx_ring_cleanup(struct lan743x_rx *rx)
 	kfree(rx->buffer_info);
 	rx->buffer_info = NULL;
 
+	page_pool_destroy(rx->page_pool);
+	rx->page_pool = NULL;
+
+	if (rx->xsk_scratch_cpu_ptr) {
+		dma_free_coherent(&rx->adapter->pdev->dev, PAGE_SIZE,
+				  rx->xsk_scratch_cpu_ptr,
+				  rx->xsk_scratch_dma_ptr);
+		rx->xsk_scratch_cpu_ptr = NULL;
+		rx->xsk_scratch_dma_ptr = 0;
+	}
+
 	if (rx->ring_cpu_ptr) {
 		dma_free_coherent(&rx->adapter->pdev->dev,
 				  rx->ring_allocation_size, rx->ring_cpu_ptr,
@@ -2954,13 +3579,14 @@ static void lan743x_rx_ring_cleanup(struct lan743x_rx *rx)
 
 static int lan743x_rx_ring_init(struct lan743x_rx *rx)
 {
+	struct page_pool_params pp_params = { 0 };
 	size_t ring_allocation_size = 0;
 	dma_addr_t dma_ptr = 0;
 	void *cpu_ptr = NULL;
 	int ret = -ENOMEM;
 	int index = 0;
 
-	rx->ring_size = LAN743X_RX_RING_SIZE;
+	rx->ring_size = rx->adapter->rx_ring_size;
 	if (rx->ring_size <= 1) {
 		ret = -EINVAL;
 		goto cleanup;
@@ -3013,6 +3639,41 @@ static int lan743x_rx_ring_init(struct lan743x_rx *rx)
 		goto cleanup;
 	}
 
+	if (rx->xsk_pool) {
+		/* buffers come from the AF_XDP UMEM */
+		cpu_ptr = dma_alloc_coherent(&rx->adapter->pdev->dev, PAGE_SIZE,
+					     &dma_ptr, GFP_KERNEL);
+		if (!cpu_ptr) {
+			ret = -ENOMEM;
+			goto cleanup;
+		}
+		rx->xsk_scratch_cpu_ptr = cpu_ptr;
+		rx->xsk_scratch_dma_ptr = dma_ptr;
+		goto init_elements;
+	}
+
+	/* the page pool maps its pages once and syncs only the area the
+	 * DMAC may have written when a page is recycled
+	 */
+	pp_params.order = 0;
+	pp_params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
+	pp_params.pool_size = rx->ring_size;
+	pp_params.nid = dev_to_node(&rx->adapter->pdev->dev);
+	pp_params.dev = &rx->adapter->pdev->dev;
+	pp_params.napi = &rx->napi;
+	/* XDP_TX sends received pages back out through their pool mapping */
+	pp_params.dma_dir = rx->adapter->xdp_prog ? DMA_BIDIRECTIONAL :
+			    DMA_FROM_DEVICE;
+	pp_params.offset = LAN743X_RX_HEADROOM;
+	pp_params.max_len = LAN743X_RX_BUF_SIZE;
+	rx->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(rx->page_pool)) {
+		ret = PTR_ERR(rx->page_pool);
+		rx->page_pool = NULL;
+		goto cleanup;
+	}
+
+init_elements:
 	rx->last_head = 0;
 	for (index = 0; index < rx->ring_size; index++) {
 		ret = lan743x_rx_init_ring_element(rx, index, GFP_KERNEL);
@@ -3048,7 +3709,9 @@ static void lan743x_rx_close(struct lan743x_rx *rx)
 	lan743x_csr_write(adapter, INT_EN_CLR,
 			  INT_BIT_DMA_RX_(rx->channel_number));
 	napi_disable(&rx->napi);
+	cancel_work_sync(&rx->dim.work);
 
+	xdp_rxq_info_unreg(&rx->xdp_rxq);
 	netif_napi_del(&rx->napi);
 
 	lan743x_rx_ring_cleanup(rx);
@@ -3066,6 +3729,27 @@ static int lan743x_rx_open(struct lan743x_rx *rx)
 		goto return_error;
 
 	netif_napi_add(adapter->netdev, &rx->napi, lan743x_rx_napi_poll);
+	memset(&rx->dim, 0, sizeof(rx->dim));
+	INIT_WORK(&rx->dim.work, lan743x_rx_dim_work);
+	rx->dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
+	ret = xdp_rxq_info_reg(&rx->xdp_rxq, adapter->netdev,
+			       rx->channel_number, rx->napi.napi_id);
+	if (ret)
+		goto napi_delete;
+
+	if (rx->xsk_pool) {
+		ret = xdp_rxq_info_reg_mem_model(&rx->xdp_rxq,
+						 MEM_TYPE_XSK_BUFF_POOL, NULL);
+		if (!ret)
+			xsk_pool_set_rxq_info(rx->xsk_pool, &rx->xdp_rxq);
+	} else {
+		ret = xdp_rxq_info_reg_mem_model(&rx->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 rx->page_pool);
+	}
+	if (ret)
+		goto rxq_unreg;
 
 	lan743x_csr_write(adapter, DMAC_CMD,
 			  DMAC_CMD_RX_SWR_(rx->channel_number));
@@ -3135,7 +3819,7 @@ static int lan743x_rx_open(struct lan743x_rx *rx)
 	rx->last_head = lan743x_csr_read(adapter, RX_HEAD(rx->channel_number));
 	if (rx->last_head) {
 		ret = -EIO;
-		goto napi_delete;
+		goto rxq_unreg;
 	}
 
 	napi_enable(&rx->napi);
@@ -3165,6 +3849,9 @@ static int lan743x_rx_open(struct lan743x_rx *rx)
 			  FCT_RX_CTL_EN_(rx->channel_number));
 	return 0;
 
+rxq_unreg:
+	xdp_rxq_info_unreg(&rx->xdp_rxq);
+
 napi_delete:
 	netif_napi_del(&rx->napi);
 	lan743x_rx_ring_cleanup(rx);
@@ -3173,16 +3860,91 @@ return_error:
 	return ret;
 }
 
-static int lan743x_netdev_close(struct net_device *netdev)
+/* let redirects from other devices and XSK wakeups that still see the
+ * channels finish before any of them is closed
+ */
+static void lan743x_netdev_xdp_tx_quiesce(struct lan743x_adapter *adapter)
+{
+	WRITE_ONCE(adapter->xdp_tx_ready, false);
+	synchronize_net();
+}
+
+/* Stop and free the DMA channels only, interrupts, MAC, PHY and PTP stay
+ * up. Channels a failed reopen already tore down are skipped.
+ */
+static void lan743x_netdev_channels_close(struct lan743x_adapter *adapter)
 {
-	struct lan743x_adapter *adapter = netdev_priv(netdev);
 	int index;
 
-	for (index = 0; index < adapter->used_tx_channels; index++)
-		lan743x_tx_close(&adapter->tx[index]);
+	lan743x_netdev_xdp_tx_quiesce(adapter);
 
-	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++)
-		lan743x_rx_close(&adapter->rx[index]);
+	for (index = 0; index < adapter->used_tx_channels; index++) {
+		if (adapter->tx[index].ring_cpu_ptr)
+			lan743x_tx_close(&adapter->tx[index]);
+	}
+
+	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++) {
+		if (adapter->rx[index].ring_cpu_ptr)
+			lan743x_rx_close(&adapter->rx[index]);
+	}
+}
+
+static int lan743x_netdev_channels_open(struct lan743x_adapter *adapter)
+{
+	int index;
+	int ret;
+
+	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++) {
+		ret = lan743x_rx_open(&adapter->rx[index]);
+		if (ret)
+			goto close_channels;
+	}
+
+	for (index = 0; index < adapter->used_tx_channels; index++) {
+		ret = lan743x_tx_open(&adapter->tx[index]);
+		if (ret)
+			goto close_channels;
+	}
+
+	WRITE_ONCE(adapter->xdp_tx_ready, true);
+	return 0;
+
+close_channels:
+	lan743x_netdev_channels_close(adapter);
+	return ret;
+}
+
+/* Ring and XDP reconfiguration only restart the DMA channels, so the
+ * link and the PHC stay up across it
+ */
+static void lan743x_netdev_channels_stop(struct lan743x_adapter *adapter)
+{
+	netif_tx_disable(adapter->netdev);
+	lan743x_netdev_channels_close(adapter);
+}
+
+/* A running interface is closed rather than left without rings */
+static int lan743x_netdev_channels_start(struct lan743x_adapter *adapter)
+{
+	int ret;
+
+	ret = lan743x_netdev_channels_open(adapter);
+	if (ret) {
+		netif_err(adapter, ifup, adapter->netdev,
+			  "failed to restart DMA channels\n");
+		dev_close(adapter->netdev);
+		return ret;
+	}
+
+	netif_tx_wake_all_queues(adapter->netdev);
+	return 0;
+}
+
+static int lan743x_netdev_close(struct net_device *netdev)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+
+	lan743x_netdev_channels_close(adapter);
 
 	lan743x_ptp_close(adapter);
 
@@ -3198,7 +3960,6 @@ static int lan743x_netdev_close(struct net_device *netdev)
 static int lan743x_netdev_open(struct net_device *netdev)
 {
 	struct lan743x_adapter *adapter = netdev_priv(netdev);
-	int index;
 	int ret;
 
 	ret = lan743x_intr_open(adapter);
@@ -3219,30 +3980,13 @@ static int lan743x_netdev_open(struct net_device *netdev)
 
 	lan743x_rfe_open(adapter);
 
-	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++) {
-		ret = lan743x_rx_open(&adapter->rx[index]);
-		if (ret)
-			goto close_rx;
-	}
+	ret = lan743x_netdev_channels_open(adapter);
+	if (ret)
+		goto close_ptp;
 
-	for (index = 0; index < adapter->used_tx_channels; index++) {
-		ret = lan743x_tx_open(&adapter->tx[index]);
-		if (ret)
-			goto close_tx;
-	}
 	return 0;
 
-close_tx:
-	for (index = 0; index < adapter->used_tx_channels; index++) {
-		if (adapter->tx[index].ring_cpu_ptr)
-			lan743x_tx_close(&adapter->tx[index]);
-	}
-
-close_rx:
-	for (index = 0; index < LAN743X_USED_RX_CHANNELS; index++) {
-		if (adapter->rx[index].ring_cpu_ptr)
-			lan743x_rx_close(&adapter->rx[index]);
-	}
+close_ptp:
 	lan743x_ptp_close(adapter);
 
 close_phy:
@@ -3260,16 +4004,110 @@ return_error:
 	return ret;
 }
 
+int lan743x_set_ring_size(struct lan743x_adapter *adapter, u32 rx_ring_size,
+			  u32 tx_ring_size)
+{
+	struct net_device *netdev = adapter->netdev;
+	u32 old_rx_ring_size = adapter->rx_ring_size;
+	u32 old_tx_ring_size = adapter->tx_ring_size;
+	int ret;
+
+	if (!netif_running(netdev)) {
+		adapter->rx_ring_size = rx_ring_size;
+		adapter->tx_ring_size = tx_ring_size;
+		return 0;
+	}
+
+	/* closing the channels quiesces their NAPI and frees the rings */
+	lan743x_netdev_channels_stop(adapter);
+	adapter->rx_ring_size = rx_ring_size;
+	adapter->tx_ring_size = tx_ring_size;
+	ret = lan743x_netdev_channels_open(adapter);
+	if (!ret) {
+		netif_tx_wake_all_queues(netdev);
+		return 0;
+	}
+
+	/* keep the interface usable with the rings it had */
+	adapter->rx_ring_size = old_rx_ring_size;
+	adapter->tx_ring_size = old_tx_ring_size;
+	lan743x_netdev_channels_start(adapter);
+
+	return ret;
+}
+
 static netdev_tx_t lan743x_netdev_xmit_frame(struct sk_buff *skb,
 					     struct net_device *netdev)
 {
 	struct lan743x_adapter *adapter = netdev_priv(netdev);
-	u8 ch = 0;
 
-	if (adapter->is_pci11x1x)
-		ch = skb->queue_mapping % PCI11X1X_USED_TX_CHANNELS;
+	/* every queue has its own channel, ring and lock */
+	return lan743x_tx_xmit_frame(&adapter->tx[skb_get_queue_mapping(skb)],
+				     skb);
+}
+
+/* mqprio gives each traffic class exactly one TX channel, so frames of
+ * a class (PTP event messages, TSN control traffic) are queued on their
+ * own ring and never sit behind bulk or TSO frames of another class.
+ */
+static int lan743x_netdev_setup_mqprio(struct net_device *netdev,
+				       struct tc_mqprio_qopt_offload *mqprio)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct tc_mqprio_qopt *qopt = &mqprio->qopt;
+	int prio, tc;
+
+	if (!adapter->is_pci11x1x)
+		return -EOPNOTSUPP;
 
-	return lan743x_tx_xmit_frame(&adapter->tx[ch], skb);
+	if (!qopt->num_tc) {
+		netdev_reset_tc(netdev);
+		lan743x_tx_reset_xps(adapter);
+		return 0;
+	}
+
+	if (mqprio->mode != TC_MQPRIO_MODE_DCB ||
+	    mqprio->shaper != TC_MQPRIO_SHAPER_DCB)
+		return -EOPNOTSUPP;
+
+	if (qopt->num_tc > netdev->real_num_tx_queues) {
+		netdev_err(netdev, "only %u traffic classes supported\n",
+			   netdev->real_num_tx_queues);
+		return -EINVAL;
+	}
+
+	for (tc = 0; tc < qopt->num_tc; tc++) {
+		if (qopt->count[tc] != 1 || qopt->offset[tc] != tc) {
+			netdev_err(netdev, "traffic class %d must use queue %d\n",
+				   tc, tc);
+			return -EINVAL;
+		}
+	}
+
+	if (netdev_set_num_tc(netdev, qopt->num_tc))
+		return -EINVAL;
+
+	for (tc = 0; tc < qopt->num_tc; tc++)
+		netdev_set_tc_queue(netdev, tc, 1, tc);
+
+	for (prio = 0; prio <= TC_BITMASK; prio++)
+		netdev_set_prio_tc_map(netdev, prio, qopt->prio_tc_map[prio]);
+
+	lan743x_tx_reset_xps(adapter);
+
+	qopt->hw = TC_MQPRIO_HW_OFFLOAD_TCS;
+	return 0;
+}
+
+static int lan743x_netdev_setup_tc(struct net_device *netdev,
+				   enum tc_setup_type type, void *type_data)
+{
+	switch (type) {
+	case TC_SETUP_QDISC_MQPRIO:
+		return lan743x_netdev_setup_mqprio(netdev, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 static int lan743x_netdev_ioctl(struct net_device *netdev,
@@ -3296,6 +4134,12 @@ static int lan743x_netdev_change_mtu(struct net_device *netdev, int new_mtu)
 	struct lan743x_adapter *adapter = netdev_priv(netdev);
 	int ret = 0;
 
+	if (adapter->xdp_prog && new_mtu > LAN743X_XDP_MAX_MTU) {
+		netdev_warn(netdev, "MTU %d too large for XDP, maximum is %d\n",
+			    new_mtu, (int)LAN743X_XDP_MAX_MTU);
+		return -EINVAL;
+	}
+
 	ret = lan743x_mac_set_mtu(adapter, new_mtu);
 	if (!ret)
 		netdev->mtu = new_mtu;
@@ -3365,15 +4209,196 @@ static int lan743x_netdev_set_mac_address(struct net_device *netdev,
 	return 0;
 }
 
+static int lan743x_netdev_xdp_setup(struct net_device *netdev,
+				    struct bpf_prog *prog,
+				    struct netlink_ext_ack *extack)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+	bool reconfigure;
+	int ret = 0;
+
+	if (prog && netdev->mtu > LAN743X_XDP_MAX_MTU) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* the page pool DMA direction and the PCI11x1x TX queue layout
+	 * depend on whether a program is attached
+	 */
+	reconfigure = !adapter->xdp_prog != !prog;
+	if (reconfigure && netif_running(netdev))
+		lan743x_netdev_channels_stop(adapter);
+
+	old_prog = xchg(&adapter->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (!reconfigure)
+		return 0;
+
+	if (adapter->is_pci11x1x) {
+		ret = netif_set_real_num_tx_queues(netdev,
+						   adapter->used_tx_channels -
+						   (prog ? 1 : 0));
+		if (!ret)
+			lan743x_tx_reset_xps(adapter);
+	}
+
+	if (netif_running(netdev)) {
+		if (ret)
+			dev_close(netdev);
+		else
+			ret = lan743x_netdev_channels_start(adapter);
+	}
+
+	return ret;
+}
+
+static int lan743x_netdev_xsk_pool_setup(struct net_device *netdev,
+					 struct xsk_buff_pool *pool, u16 qid)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct lan743x_tx *tx = lan743x_xdp_tx_ring(adapter);
+	bool running = netif_running(netdev);
+	struct xsk_buff_pool *old_pool;
+	struct netdev_queue *txq;
+	struct lan743x_rx *rx;
+	int ret;
+
+	if (qid >= LAN743X_USED_RX_CHANNELS)
+		return -EINVAL;
+
+	rx = &adapter->rx[qid];
+	old_pool = rx->xsk_pool;
+	if (!pool && !old_pool)
+		return -EINVAL;
+
+	if (pool) {
+		ret = xsk_pool_dma_map(pool, &adapter->pdev->dev, 0);
+		if (ret)
+			return ret;
+	}
+
+	/* the RX ring switches buffer source and the XDP TX channel may
+	 * still own UMEM frames of the old pool, the other channels keep
+	 * running
+	 */
+	if (running) {
+		txq = netdev_get_tx_queue(netdev, tx->channel_number);
+		__netif_tx_lock_bh(txq);
+		netif_tx_stop_queue(txq);
+		__netif_tx_unlock_bh(txq);
+		lan743x_netdev_xdp_tx_quiesce(adapter);
+		lan743x_tx_close(tx);
+		lan743x_rx_close(rx);
+	}
+
+	WRITE_ONCE(rx->xsk_pool, pool);
+	if (old_pool)
+		xsk_pool_dma_unmap(old_pool, 0);
+
+	if (!running)
+		return 0;
+
+	ret = lan743x_rx_open(rx);
+	if (!ret) {
+		ret = lan743x_tx_open(tx);
+		if (ret)
+			lan743x_rx_close(rx);
+	}
+	if (ret) {
+		netif_err(adapter, ifup, netdev,
+			  "failed to restart DMA channels\n");
+		dev_close(netdev);
+		return ret;
+	}
+
+	WRITE_ONCE(adapter->xdp_tx_ready, true);
+	netif_tx_wake_queue(txq);
+	return 0;
+}
+
+static int lan743x_netdev_bpf(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return lan743x_netdev_xdp_setup(netdev, bpf->prog, bpf->extack);
+	case XDP_SETUP_XSK_POOL:
+		return lan743x_netdev_xsk_pool_setup(netdev, bpf->xsk.pool,
+						     bpf->xsk.queue_id);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int lan743x_netdev_xdp_xmit(struct net_device *netdev, int n,
+				   struct xdp_frame **frames, u32 flags)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct lan743x_tx *tx;
+	int nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	/* the XDP channel is only set aside while a program is attached */
+	if (!READ_ONCE(adapter->xdp_tx_ready) || !READ_ONCE(adapter->xdp_prog))
+		return -ENXIO;
+
+	tx = lan743x_xdp_tx_ring(adapter);
+	spin_lock(&tx->ring_lock);
+	for (nxmit = 0; nxmit < n; nxmit++) {
+		if (lan743x_tx_xdp_frame(tx, frames[nxmit], true))
+			break;
+	}
+	if (flags & XDP_XMIT_FLUSH)
+		lan743x_tx_xdp_flush(tx);
+	spin_unlock(&tx->ring_lock);
+
+	return nxmit;
+}
+
+static int lan743x_netdev_xsk_wakeup(struct net_device *netdev, u32 qid,
+				     u32 flags)
+{
+	struct lan743x_adapter *adapter = netdev_priv(netdev);
+	struct napi_struct *napi;
+
+	if (!READ_ONCE(adapter->xdp_tx_ready) || !READ_ONCE(adapter->xdp_prog))
+		return -ENETDOWN;
+
+	if (qid >= LAN743X_USED_RX_CHANNELS || !adapter->rx[qid].xsk_pool)
+		return -ENXIO;
+
+	if (flags & XDP_WAKEUP_RX) {
+		napi = &adapter->rx[qid].napi;
+		if (!napi_if_scheduled_mark_missed(napi))
+			napi_schedule(napi);
+	}
+
+	if (flags & XDP_WAKEUP_TX) {
+		napi = &lan743x_xdp_tx_ring(adapter)->napi;
+		if (!napi_if_scheduled_mark_missed(napi))
+			napi_schedule(napi);
+	}
+
+	return 0;
+}
+
 static const struct net_device_ops lan743x_netdev_ops = {
 	.ndo_open		= lan743x_netdev_open,
 	.ndo_stop		= lan743x_netdev_close,
 	.ndo_start_xmit		= lan743x_netdev_xmit_frame,
+	.ndo_setup_tc		= lan743x_netdev_setup_tc,
 	.ndo_eth_ioctl		= lan743x_netdev_ioctl,
 	.ndo_set_rx_mode	= lan743x_netdev_set_multicast,
 	.ndo_change_mtu		= lan743x_netdev_change_mtu,
 	.ndo_get_stats64	= lan743x_netdev_get_stats64,
 	.ndo_set_mac_address	= lan743x_netdev_set_mac_address,
+	.ndo_bpf		= lan743x_netdev_bpf,
+	.ndo_xdp_xmit		= lan743x_netdev_xdp_xmit,
+	.ndo_xsk_wakeup		= lan743x_netdev_xsk_wakeup,
 };
 
 static void lan743x_hardware_cleanup(struct lan743x_adapter *adapter)
@@ -3419,6 +4444,12 @@ static int lan743x_hardware_init(struct lan743x_adapter *adapter,
 	}
 
 	adapter->intr.irq = adapter->pdev->irq;
+	adapter->rx_copybreak = LAN743X_RX_COPYBREAK_DEFAULT;
+	adapter->tx_copybreak = LAN743X_TX_COPYBREAK_DEFAULT;
+	adapter->rx_ring_size = LAN743X_RX_RING_SIZE;
+	adapter->tx_ring_size = LAN743X_TX_RING_SIZE;
+	adapter->rx_coalesce_usecs = LAN743X_INT_MOD;
+	adapter->tx_coalesce_usecs = LAN743X_INT_MOD;
 	lan743x_csr_write(adapter, INT_EN_CLR, 0xFFFFFFFF);
 
 	ret = lan743x_gpio_init(adapter);
@@ -3591,6 +4622,10 @@ static int lan743x_pcidev_probe(struct pci_dev *pdev,
 	adapter->netdev->features = NETIF_F_SG | NETIF_F_TSO |
 				    NETIF_F_HW_CSUM | NETIF_F_RXCSUM;
 	adapter->netdev->hw_features = adapter->netdev->features;
+	adapter->netdev->xdp_features = NETDEV_XDP_ACT_BASIC |
+					NETDEV_XDP_ACT_REDIRECT |
+					NETDEV_XDP_ACT_NDO_XMIT |
+					NETDEV_XDP_ACT_XSK_ZEROCOPY;
 
 	/* carrier off reporting is important to ethtool even BEFORE open */
 	netif_carrier_off(netdev);
@@ -6,6 +6,9 @@
 
 #include <linux/phy.h>
 #include <linux/irq.h>
+#include <linux/bpf.h>
+#include <linux/dim.h>
+#include <net/xdp.h>
 #include "lan743x_ptp.h"
 
 #define DRIVER_AUTHOR   "Bryan Whitehead <Bryan.Whitehead@microchip.com>"
@@ -428,6 +431,7 @@
 #define INT_MOD_CFG7			(0x7DC)
 #define INT_MOD_CFG8			(0x7E0)
 #define INT_MOD_CFG9			(0x7E4)
+#define INT_MOD_CFG(index)		(0x7C0 + ((index) << 2))
 
 #define PTP_CMD_CTL					(0x0A00)
 #define PTP_CMD_CTL_PTP_LTC_TARGET_READ_		BIT(13)
@@ -840,6 +844,13 @@ struct lan743x_adapter;
 #define LAN743X_USED_TX_CHANNELS	(1)
 #define PCI11X1X_USED_TX_CHANNELS	(4)
 #define LAN743X_INT_MOD	(400)
+#define LAN743X_INT_MOD_MAX	(4095)
+
+/* moderation timers the channels are bound to by INT_MOD_MAP0/1 */
+#define LAN743X_INT_MOD_RX(channel)	(2 + (channel))
+#define LAN743X_INT_MOD_TX(channel)	(1)
+#define PCI11X1X_INT_MOD_RX(channel)	(4 + (channel))
+#define PCI11X1X_INT_MOD_TX(channel)	(channel)
 
 #if (LAN743X_USED_RX_CHANNELS > LAN743X_MAX_RX_CHANNELS)
 #error Invalid LAN743X_USED_RX_CHANNELS
@@ -974,7 +985,21 @@ struct lan743x_tx {
 
 	struct napi_struct napi;
 	u32 frame_count;
-	u32 rqd_descriptors;
+	/* default XPS map installed, later changes belong to the admin */
+	bool		xps_init_done;
+
+	/* one LAN743X_TX_BOUNCE_SIZE slot per descriptor, small frames are
+	 * copied here instead of being mapped
+	 */
+	void		*bounce_cpu_ptr;
+	dma_addr_t	bounce_dma_ptr;
+	u64		bounced_frames;
+
+	/* skbs completed since open, feed net_dim and BQL */
+	struct dim	dim;
+	u16		dim_events;
+	u64		completed_packets;
+	u64		completed_bytes;
 };
 
 void lan743x_tx_set_timestamping_mode(struct lan743x_tx *tx,
@@ -996,6 +1021,17 @@ struct lan743x_rx {
 	dma_addr_t ring_dma_ptr;
 
 	struct lan743x_rx_buffer_info *buffer_info;
+	struct page_pool *page_pool;
+	struct xdp_rxq_info xdp_rxq;
+	/* XDP verdicts taken during the current poll needing a flush */
+	u32 xdp_flush;
+
+	/* AF_XDP zero-copy. Descriptors that could not get a UMEM frame
+	 * point at the scratch buffer and whatever lands there is dropped.
+	 */
+	struct xsk_buff_pool *xsk_pool;
+	void		*xsk_scratch_cpu_ptr;
+	dma_addr_t	xsk_scratch_dma_ptr;
 
 	__le32		*head_cpu_ptr;
 	dma_addr_t	head_dma_ptr;
@@ -1005,8 +1041,16 @@ struct lan743x_rx {
 	struct napi_struct napi;
 
 	u32		frame_count;
+	/* frames spanning several buffers, XDP only runs on single ones */
+	u64		xdp_multi_buf_drops;
+
+	/* net_dim samples, frames passed to the stack since open */
+	struct dim	dim;
+	u16		dim_events;
+	u64		dim_packets;
+	u64		dim_bytes;
 
-	struct sk_buff *skb_head, *skb_tail;
+	struct sk_buff *skb_head;
 };
 
 int lan743x_rx_set_tstamp_mode(struct lan743x_adapter *adapter,
@@ -1060,6 +1104,20 @@ struct lan743x_adapter {
 	u8			used_tx_channels;
 	u8			max_vector_count;
 
+	struct bpf_prog		*xdp_prog;
+	/* set while the channels are open, gates ndo_xdp_xmit and
+	 * ndo_xsk_wakeup while the interface is being reconfigured
+	 */
+	bool			xdp_tx_ready;
+	u32			rx_copybreak;
+	u32			tx_copybreak;
+	u32			rx_ring_size;
+	u32			tx_ring_size;
+	u32			rx_coalesce_usecs;
+	u32			tx_coalesce_usecs;
+	bool			rx_dim_enabled;
+	bool			tx_dim_enabled;
+
 #define LAN743X_ADAPTER_FLAG_OTP		BIT(0)
 	u32			flags;
 	u32			hw_cfg;
@@ -1126,9 +1184,17 @@ struct lan743x_tx_descriptor {
 #define TX_BUFFER_INFO_FLAG_TIMESTAMP_REQUESTED	BIT(1)
 #define TX_BUFFER_INFO_FLAG_IGNORE_SYNC		BIT(2)
 #define TX_BUFFER_INFO_FLAG_SKB_FRAGMENT	BIT(3)
+/* buffer is an RX page pool page sent back by XDP_TX, not mapped by TX */
+#define TX_BUFFER_INFO_FLAG_XDP_TX		BIT(4)
+/* buffer is an AF_XDP UMEM frame, mapped by its buffer pool */
+#define TX_BUFFER_INFO_FLAG_XSK			BIT(5)
+/* buffer is the descriptor's slot in the pre-mapped bounce area */
+#define TX_BUFFER_INFO_FLAG_BOUNCE		BIT(6)
 struct lan743x_tx_buffer_info {
 	int flags;
 	struct sk_buff *skb;
+	struct xdp_frame *xdpf;
+	struct xsk_buff_pool *xsk_pool;
 	dma_addr_t      dma_ptr;
 	unsigned int    buffer_length;
 };
@@ -1137,6 +1203,18 @@ struct lan743x_tx_buffer_info {
 #define LAN734X_NUM_TESTS 1
 
 #define LAN743X_TX_RING_SIZE    (128)
+/* a maximally fragmented skb plus its extension descriptor */
+#define LAN743X_TX_DESC_MAX_PER_SKB	(MAX_SKB_FRAGS + 2)
+/* the queue stops when another skb may not fit and restarts with room
+ * for two
+ */
+#define LAN743X_TX_STOP_THRS		(LAN743X_TX_DESC_MAX_PER_SKB)
+#define LAN743X_TX_START_THRS		(2 * LAN743X_TX_DESC_MAX_PER_SKB)
+#define LAN743X_TX_RING_SIZE_MIN	(4 * LAN743X_TX_DESC_MAX_PER_SKB)
+
+#define LAN743X_TX_BOUNCE_SIZE		(256)
+#define LAN743X_TX_COPYBREAK_DEFAULT	(128)
+#define LAN743X_TX_RING_SIZE_MAX	(4096)
 
 /* OWN bit is set. ie, Descs are owned by RX DMAC */
 #define RX_DESC_DATA0_OWN_                (0x00008000)
@@ -1159,6 +1237,22 @@ struct lan743x_tx_buffer_info {
 
 #define RX_HEAD_PADDING		NET_IP_ALIGN
 
+/* RX buffers are page_pool pages. The frame is written after
+ * LAN743X_RX_HEADROOM and the end of the page is left for the
+ * skb_shared_info of the skb built around it.
+ */
+#define LAN743X_RX_HEADROOM	XDP_PACKET_HEADROOM
+#define LAN743X_RX_BUF_SIZE	min_t(unsigned int,			\
+				      RX_DESC_DATA0_BUF_LENGTH_MASK_,	\
+				      PAGE_SIZE - LAN743X_RX_HEADROOM -	\
+				      SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+/* frames up to this size are copied and their page stays on the ring */
+#define LAN743X_RX_COPYBREAK_DEFAULT	(256)
+
+/* XDP runs on frames held in a single RX buffer */
+#define LAN743X_XDP_MAX_MTU	(LAN743X_RX_BUF_SIZE - RX_HEAD_PADDING -	\
+				 ETH_HLEN - VLAN_HLEN - ETH_FCS_LEN)
+
 struct lan743x_rx_descriptor {
 	__le32     data0;
 	__le32     data1;
@@ -1169,13 +1263,21 @@ struct lan743x_rx_descriptor {
 #define RX_BUFFER_INFO_FLAG_ACTIVE      BIT(0)
 struct lan743x_rx_buffer_info {
 	int flags;
-	struct sk_buff *skb;
+	struct page *page;
+	struct xdp_buff *xsk_buff;
 
 	dma_addr_t      dma_ptr;
 	unsigned int    buffer_length;
 };
 
 #define LAN743X_RX_RING_SIZE        (128)
+#define LAN743X_RX_RING_SIZE_MIN	(16)
+#define LAN743X_RX_RING_SIZE_MAX	(4096)
+/* consumed descriptors are handed back to the DMAC in batches of this */
+#define LAN743X_RX_REFILL_BATCH		(16)
+
+#define LAN743X_XDP_FLUSH_TX		BIT(0)
+#define LAN743X_XDP_FLUSH_REDIRECT	BIT(1)
 
 #define RX_PROCESS_RESULT_NOTHING_TO_DO     (0)
 #define RX_PROCESS_RESULT_BUFFER_RECEIVED   (1)
@@ -1187,5 +1289,8 @@ void lan743x_hs_syslock_release(struct lan743x_adapter *adapter);
 void lan743x_mac_flow_ctrl_set_enables(struct lan743x_adapter *adapter,
 				       bool tx_enable, bool rx_enable);
 int lan743x_sgmii_read(struct lan743x_adapter *adapter, u8 mmd, u16 addr);
+void lan743x_intr_set_moderation(struct lan743x_adapter *adapter);
+int lan743x_set_ring_size(struct lan743x_adapter *adapter, u32 rx_ring_size,
+			  u32 tx_ring_size);
 
 #endif /* _LAN743X_H */
@@ -9,10 +9,15 @@
 #include <linux/ethtool.h>
 #include <linux/ethtool_netlink.h>
 #include <linux/bitfield.h>
+#include <linux/hashtable.h>
+#include <linux/llist.h>
 #include <linux/net_tstamp.h>
 #include <linux/ptp_clock_kernel.h>
 #include <linux/ptp_classify.h>
 
+#define CREATE_TRACE_POINTS
+#include "microchip_t1_trace.h"
+
 #define PHY_ID_LAN87XX				0x0007c150
 #define PHY_ID_LAN937X				0x0007c180
 
@@ -403,7 +408,27 @@
 #define LAN887X_PTP_TX_LATENCY_100			(1079)
 
 #define FIFO_SIZE					8
+/* Pending RX timestamps and skbs are hashed by PTP sequenceId */
+#define LAN887X_PTP_HASH_BITS				4
+#define LAN887X_PTP_HASH_SIZE				BIT(LAN887X_PTP_HASH_BITS)
+/* Preallocated RX timestamp records, a few hardware FIFOs deep */
+#define LAN887X_PTP_RX_TS_POOL_SIZE			(FIFO_SIZE * 4)
+/* Rx skbs allowed to wait for their timestamp */
+#define LAN887X_PTP_RX_MAX_PENDING			LAN887X_PTP_RX_TS_POOL_SIZE
+/* Time an unmatched RX frame or timestamp is kept */
+#define LAN887X_PTP_RX_MAX_AGE_MS			100
 #define LAN887X_MAX_ADJ					31249999
+/* Largest phase offset handed to adjphase, below one second */
+#define LAN887X_MAX_PHASE				(NSEC_PER_SEC - 1)
+/* The HW allows up to 15 sec to adjust the time, but here we limit to
+ * 10 sec the adjustment. The reason is, in case the adjustment is 14
+ * sec and 999999999 nsec, then we add 8ns to compansate the actual
+ * increment so the value can be bigger than 15 sec. Therefore limit the
+ * possible adjustments so we will not have these corner cases
+ */
+#define LAN887X_PTP_STEP_MAX_NS				(10LL * NSEC_PER_SEC)
+/* How long the last known LTC time can be extrapolated from */
+#define LAN887X_LTC_REF_MAX_AGE_MS			10000
 
 /* PTP PRT Registers */
 /* PTP Interrupt Enable Register */
@@ -1329,6 +1354,26 @@ struct lan887x_regwr_map {
 	u16 val;
 };
 
+struct lan887x_ptp_event {
+	/* GPIO driven by the event, -1 when the event is unused */
+	int pin;
+	/* Grid of the output edges in LTC time */
+	s64 start_ns;
+	s64 period_ns;
+};
+
+struct lan887x_ptp_stats {
+	u64 rx_ts_pool_exhausted;
+	u64 rx_matched;
+	u64 rx_skb_aged;
+	u64 rx_ts_aged;
+	u64 rx_skb_overflow;
+	u64 rx_fifo_overflow;
+	u64 rate_writes;
+	u64 rate_writes_skipped;
+	u64 tx_ts_unmatched;
+};
+
 struct lan887x_ptp_priv {
 	enum hwtstamp_rx_filters rx_filter;
 
@@ -1336,26 +1381,43 @@ struct lan887x_ptp_priv {
 	struct ptp_pin_desc *pin_config;
 
 	struct sk_buff_head tx_queue;
-	struct sk_buff_head rx_queue;
+	/* Rx skbs waiting for a timestamp, bucketed by sequenceId */
+	struct sk_buff_head rx_skb_hash[LAN887X_PTP_HASH_SIZE];
 
 	struct ptp_clock_info caps;
 	struct ptp_clock *ptp_clock;
-	struct list_head rx_ts_list;
+	/* Rx timestamps waiting for an skb, keyed by sequenceId */
+	DECLARE_HASHTABLE(rx_ts_hash, LAN887X_PTP_HASH_BITS);
+	/* Unused entries of rx_ts_pool */
+	struct llist_head rx_ts_free;
+	struct lan887x_ptp_rx_ts *rx_ts_pool;
 
 	struct phy_device *phydev;
 
 	/* Lock for phc */
 	struct mutex ptp_lock;
-
-	/* Lock for Rx ts fifo */
+	/* Last LTC time read or written and when, protected by ptp_lock */
+	struct timespec64 ltc_ref;
+	ktime_t ltc_ref_mono;
+	bool ltc_ref_valid;
+	/* Last rate adjustment written to the LTC, protected by ptp_lock */
+	u16 rate_hi;
+	u16 rate_lo;
+	bool rate_valid;
+
+	/* Lock for rx_skb_hash and rx_ts_hash */
 	spinlock_t rx_ts_lock;
+	unsigned int rx_skb_count;
+	unsigned int rx_ts_count;
 
-	int lan887x_event_a;
-	int lan887x_event_b;
+	/* Periodic outputs, protected by ptp_lock */
+	struct lan887x_ptp_event event[LAN887X_N_PEROUT];
 
 	int hwts_tx_type;
 	int version;
 	int layer;
+
+	struct lan887x_ptp_stats stats;
 };
 
 struct lan887x_type {
@@ -1370,12 +1432,42 @@ struct lan887x_priv {
 };
 
 struct lan887x_ptp_rx_ts {
-	struct list_head list;
+	struct hlist_node node;
+	struct llist_node free_node;
+	unsigned long enqueued;
 	u32 seconds;
 	u16 seq_id;
 	u32 nsec;
 };
 
+/* PTP signature of a queued rx skb, computed once when it is queued */
+struct lan887x_skb_cb {
+	unsigned long enqueued;
+	u16 seq_id;
+};
+
+#define LAN887X_SKB_CB(skb)	((struct lan887x_skb_cb *)(skb)->cb)
+
+struct lan887x_ptp_stat {
+	const char *string;
+	size_t offset;
+};
+
+#define LAN887X_PTP_STAT(_string, _member) \
+	{ _string, offsetof(struct lan887x_ptp_stats, _member) }
+
+static const struct lan887x_ptp_stat lan887x_ptp_stats[] = {
+	LAN887X_PTP_STAT("PTP RX TS pool exhausted", rx_ts_pool_exhausted),
+	LAN887X_PTP_STAT("PTP RX matched", rx_matched),
+	LAN887X_PTP_STAT("PTP RX skb aged", rx_skb_aged),
+	LAN887X_PTP_STAT("PTP RX TS aged", rx_ts_aged),
+	LAN887X_PTP_STAT("PTP RX skb overflow", rx_skb_overflow),
+	LAN887X_PTP_STAT("PTP RX TS FIFO overflow", rx_fifo_overflow),
+	LAN887X_PTP_STAT("PTP rate adj writes", rate_writes),
+	LAN887X_PTP_STAT("PTP rate adj writes skipped", rate_writes_skipped),
+	LAN887X_PTP_STAT("PTP TX TS unmatched", tx_ts_unmatched),
+};
+
 static int lan887x_cd_reset(struct phy_device *phydev, bool cd_done);
 /**********************************************/
 // Internal APIs to be called with-in driver
@@ -1657,8 +1749,9 @@ static void lan887x_txtstamp(struct mii_timestamper *mii_ts,
 
 	switch (ptp_priv->hwts_tx_type) {
 	case HWTSTAMP_TX_ONESTEP_SYNC:
+		/* The TSU inserts the egress time in the Sync itself */
 		if (is_sync(skb, type)) {
-			kfree_skb(skb);
+			consume_skb(skb);
 			return;
 		}
 		fallthrough;
@@ -1673,103 +1766,207 @@ static void lan887x_txtstamp(struct mii_timestamper *mii_ts,
 	}
 }
 
-static void lan887x_get_sig_rx(struct sk_buff *skb, u16 *sig)
+static struct sk_buff_head *lan887x_rx_skb_bucket(struct lan887x_ptp_priv *ptp_priv,
+						  u16 seq_id)
 {
-	struct ptp_header *ptp_header;
-	u32 type;
+	return &ptp_priv->rx_skb_hash[hash_min(seq_id, LAN887X_PTP_HASH_BITS)];
+}
 
-	skb_push(skb, ETH_HLEN);
-	type = ptp_classify_raw(skb);
-	ptp_header = ptp_parse_header(skb, type);
-	skb_pull_inline(skb, ETH_HLEN);
+static struct lan887x_ptp_rx_ts *lan887x_rx_ts_alloc(struct lan887x_ptp_priv *ptp_priv)
+{
+	struct llist_node *node;
+
+	/* Entries are only taken from the free list by the PHY interrupt
+	 * thread, so llist_del_first() needs no further serialization.
+	 */
+	node = llist_del_first(&ptp_priv->rx_ts_free);
+	if (!node) {
+		ptp_priv->stats.rx_ts_pool_exhausted++;
+		return NULL;
+	}
 
-	*sig = ntohs(ptp_header->sequence_id);
+	return llist_entry(node, struct lan887x_ptp_rx_ts, free_node);
 }
 
-static bool lan887x_match_skb(struct lan887x_ptp_priv *ptp_priv,
-			      struct lan887x_ptp_rx_ts *rx_ts)
+static void lan887x_rx_ts_free(struct lan887x_ptp_priv *ptp_priv,
+			       struct lan887x_ptp_rx_ts *rx_ts)
 {
-	struct skb_shared_hwtstamps *shhwtstamps;
-	struct sk_buff *skb, *skb_tmp;
-	unsigned long flags;
-	bool ret = false;
-	u16 skb_sig;
-
-	spin_lock_irqsave(&ptp_priv->rx_queue.lock, flags);
-	skb_queue_walk_safe(&ptp_priv->rx_queue, skb, skb_tmp) {
-		lan887x_get_sig_rx(skb, &skb_sig);
+	llist_add(&rx_ts->free_node, &ptp_priv->rx_ts_free);
+}
 
-		if (memcmp(&skb_sig, &rx_ts->seq_id, sizeof(rx_ts->seq_id)))
-			continue;
+static unsigned long lan887x_ptp_rx_max_age(void)
+{
+	return msecs_to_jiffies(LAN887X_PTP_RX_MAX_AGE_MS) ?: 1;
+}
 
-		__skb_unlink(skb, &ptp_priv->rx_queue);
+static bool lan887x_ptp_rx_expired(unsigned long enqueued)
+{
+	return time_after(jiffies, enqueued + lan887x_ptp_rx_max_age());
+}
 
-		ret = true;
-		break;
-	}
-	spin_unlock_irqrestore(&ptp_priv->rx_queue.lock, flags);
+/* Start the reaper when the first unmatched entry gets queued */
+static void lan887x_ptp_rx_kick_reaper(struct lan887x_ptp_priv *ptp_priv)
+{
+	ptp_schedule_worker(ptp_priv->ptp_clock, lan887x_ptp_rx_max_age());
+}
 
-	if (ret) {
-		shhwtstamps = skb_hwtstamps(skb);
-		memset(shhwtstamps, 0, sizeof(*shhwtstamps));
-		shhwtstamps->hwtstamp = ktime_set(rx_ts->seconds, rx_ts->nsec);
-		netif_rx(skb);
-	}
+static void lan887x_rx_deliver(struct sk_buff *skb, u32 seconds, u32 nsec)
+{
+	struct skb_shared_hwtstamps *shhwtstamps;
 
-	return ret;
+	shhwtstamps = skb_hwtstamps(skb);
+	memset(shhwtstamps, 0, sizeof(*shhwtstamps));
+	shhwtstamps->hwtstamp = ktime_set(seconds, nsec);
+	netif_rx(skb);
 }
 
 static void lan887x_match_rx_ts(struct lan887x_ptp_priv *ptp_priv,
 				struct lan887x_ptp_rx_ts *rx_ts)
 {
-	unsigned long flags;
+	struct sk_buff_head *bucket;
+	struct sk_buff *skb;
+	bool kick;
+
+	bucket = lan887x_rx_skb_bucket(ptp_priv, rx_ts->seq_id);
+
+	spin_lock_bh(&ptp_priv->rx_ts_lock);
+	skb_queue_walk(bucket, skb) {
+		if (LAN887X_SKB_CB(skb)->seq_id != rx_ts->seq_id)
+			continue;
+
+		__skb_unlink(skb, bucket);
+		ptp_priv->rx_skb_count--;
+		ptp_priv->stats.rx_matched++;
+		spin_unlock_bh(&ptp_priv->rx_ts_lock);
 
-	/* If we failed to match the skb add it to the queue for when
+		lan887x_rx_deliver(skb, rx_ts->seconds, rx_ts->nsec);
+		lan887x_rx_ts_free(ptp_priv, rx_ts);
+		return;
+	}
+
+	/* If we failed to match the skb add it to the table for when
 	 * the frame will come
 	 */
-	if (!lan887x_match_skb(ptp_priv, rx_ts)) {
-		spin_lock_irqsave(&ptp_priv->rx_ts_lock, flags);
-		list_add(&rx_ts->list, &ptp_priv->rx_ts_list);
-		spin_unlock_irqrestore(&ptp_priv->rx_ts_lock, flags);
-	} else {
-		kfree(rx_ts);
-	}
+	rx_ts->enqueued = jiffies;
+	hash_add(ptp_priv->rx_ts_hash, &rx_ts->node, rx_ts->seq_id);
+	kick = !ptp_priv->rx_ts_count++ && !ptp_priv->rx_skb_count;
+	spin_unlock_bh(&ptp_priv->rx_ts_lock);
+
+	if (kick)
+		lan887x_ptp_rx_kick_reaper(ptp_priv);
 }
 
 static void lan887x_match_rx_skb(struct lan887x_ptp_priv *ptp_priv,
 				 struct sk_buff *skb)
 {
-	struct skb_shared_hwtstamps *shhwtstamps;
-	struct lan887x_ptp_rx_ts *rx_ts, *tmp;
-	unsigned long flags;
-	bool ret = false;
-	u16 skb_sig;
-
-	lan887x_get_sig_rx(skb, &skb_sig);
+	u16 seq_id = LAN887X_SKB_CB(skb)->seq_id;
+	struct lan887x_ptp_rx_ts *rx_ts;
+	bool kick;
 
-	/* Iterate over all RX timestamps and match it with the received skbs */
-	spin_lock_irqsave(&ptp_priv->rx_ts_lock, flags);
-	list_for_each_entry_safe(rx_ts, tmp, &ptp_priv->rx_ts_list, list) {
-		/* Check if we found the signature we were looking for. */
-		if (memcmp(&skb_sig, &rx_ts->seq_id, sizeof(rx_ts->seq_id)))
+	spin_lock_bh(&ptp_priv->rx_ts_lock);
+	hash_for_each_possible(ptp_priv->rx_ts_hash, rx_ts, node, seq_id) {
+		if (rx_ts->seq_id != seq_id)
 			continue;
 
-		shhwtstamps = skb_hwtstamps(skb);
-		memset(shhwtstamps, 0, sizeof(*shhwtstamps));
-		shhwtstamps->hwtstamp = ktime_set(rx_ts->seconds,
-						  rx_ts->nsec);
+		hash_del(&rx_ts->node);
+		ptp_priv->rx_ts_count--;
+		ptp_priv->stats.rx_matched++;
+		spin_unlock_bh(&ptp_priv->rx_ts_lock);
+
+		lan887x_rx_deliver(skb, rx_ts->seconds, rx_ts->nsec);
+		lan887x_rx_ts_free(ptp_priv, rx_ts);
+		return;
+	}
+
+	if (ptp_priv->rx_skb_count >= LAN887X_PTP_RX_MAX_PENDING) {
+		/* No room to wait for the timestamp, pass the frame on without it */
+		ptp_priv->stats.rx_skb_overflow++;
+		spin_unlock_bh(&ptp_priv->rx_ts_lock);
 		netif_rx(skb);
+		return;
+	}
 
-		list_del(&rx_ts->list);
-		kfree(rx_ts);
+	LAN887X_SKB_CB(skb)->enqueued = jiffies;
+	__skb_queue_tail(lan887x_rx_skb_bucket(ptp_priv, seq_id), skb);
+	kick = !ptp_priv->rx_skb_count++ && !ptp_priv->rx_ts_count;
+	spin_unlock_bh(&ptp_priv->rx_ts_lock);
 
-		ret = true;
-		break;
+	if (kick)
+		lan887x_ptp_rx_kick_reaper(ptp_priv);
+}
+
+static void lan887x_ptp_purge_rx_skbs(struct lan887x_ptp_priv *ptp_priv)
+{
+	int i;
+
+	spin_lock_bh(&ptp_priv->rx_ts_lock);
+	for (i = 0; i < LAN887X_PTP_HASH_SIZE; i++)
+		__skb_queue_purge(&ptp_priv->rx_skb_hash[i]);
+	ptp_priv->rx_skb_count = 0;
+	spin_unlock_bh(&ptp_priv->rx_ts_lock);
+}
+
+static void lan887x_ptp_purge_rx_ts(struct lan887x_ptp_priv *ptp_priv)
+{
+	struct lan887x_ptp_rx_ts *rx_ts;
+	struct hlist_node *tmp;
+	int bkt;
+
+	spin_lock_bh(&ptp_priv->rx_ts_lock);
+	hash_for_each_safe(ptp_priv->rx_ts_hash, bkt, tmp, rx_ts, node) {
+		hash_del(&rx_ts->node);
+		lan887x_rx_ts_free(ptp_priv, rx_ts);
+	}
+	ptp_priv->rx_ts_count = 0;
+	spin_unlock_bh(&ptp_priv->rx_ts_lock);
+}
+
+static long lan887x_ptp_do_aux_work(struct ptp_clock_info *info)
+{
+	struct lan887x_ptp_priv *ptp_priv = container_of(info,
+							 struct lan887x_ptp_priv,
+							 caps);
+	struct lan887x_ptp_rx_ts *rx_ts;
+	struct sk_buff_head *bucket;
+	struct sk_buff_head aged;
+	struct hlist_node *tmp;
+	struct sk_buff *skb;
+	bool pending;
+	int i;
+
+	__skb_queue_head_init(&aged);
+
+	spin_lock_bh(&ptp_priv->rx_ts_lock);
+	for (i = 0; i < LAN887X_PTP_HASH_SIZE; i++) {
+		bucket = &ptp_priv->rx_skb_hash[i];
+
+		/* Buckets are filled at the tail, so oldest skbs come first */
+		while ((skb = skb_peek(bucket)) &&
+		       lan887x_ptp_rx_expired(LAN887X_SKB_CB(skb)->enqueued)) {
+			__skb_unlink(skb, bucket);
+			__skb_queue_tail(&aged, skb);
+			ptp_priv->rx_skb_count--;
+			ptp_priv->stats.rx_skb_aged++;
+		}
+	}
+
+	hash_for_each_safe(ptp_priv->rx_ts_hash, i, tmp, rx_ts, node) {
+		if (!lan887x_ptp_rx_expired(rx_ts->enqueued))
+			continue;
+
+		hash_del(&rx_ts->node);
+		lan887x_rx_ts_free(ptp_priv, rx_ts);
+		ptp_priv->rx_ts_count--;
+		ptp_priv->stats.rx_ts_aged++;
 	}
-	spin_unlock_irqrestore(&ptp_priv->rx_ts_lock, flags);
+	pending = ptp_priv->rx_skb_count || ptp_priv->rx_ts_count;
+	spin_unlock_bh(&ptp_priv->rx_ts_lock);
+
+	/* The timestamp of these frames is lost, deliver them without it */
+	while ((skb = __skb_dequeue(&aged)))
+		netif_rx(skb);
 
-	if (!ret)
-		skb_queue_tail(&ptp_priv->rx_queue, skb);
+	return pending ? lan887x_ptp_rx_max_age() : -1;
 }
 
 static bool lan887x_rxtstamp(struct mii_timestamper *mii_ts,
@@ -1778,6 +1975,7 @@ static bool lan887x_rxtstamp(struct mii_timestamper *mii_ts,
 	struct lan887x_ptp_priv *ptp_priv = container_of(mii_ts,
 							 struct lan887x_ptp_priv,
 							 mii_ts);
+	struct ptp_header *ptp_header;
 	int ret = false;
 
 	if (ptp_priv->rx_filter == HWTSTAMP_FILTER_NONE)
@@ -1786,6 +1984,12 @@ static bool lan887x_rxtstamp(struct mii_timestamper *mii_ts,
 	if ((type & ptp_priv->version) == 0 || (type & ptp_priv->layer) == 0)
 		goto ret_err;
 
+	ptp_header = ptp_parse_header(skb, type);
+	if (!ptp_header)
+		goto ret_err;
+
+	LAN887X_SKB_CB(skb)->seq_id = ntohs(ptp_header->sequence_id);
+
 	ret = true;
 	/* Here if match occurs skb is sent to application, If not skb is added to queue
 	 * and sending skb to application will get handled when interrupt occurs i.e.,
@@ -1824,7 +2028,6 @@ static void lan887x_ptp_config_latency(struct phy_device *phydev)
 
 static int lan887x_hwtstamp(struct mii_timestamper *mii_ts, struct ifreq *ifr)
 {
-	struct lan887x_ptp_rx_ts *rx_ts, *tmp;
 	struct lan887x_ptp_priv *ptp_priv;
 	struct hwtstamp_config config;
 	struct phy_device *phydev;
@@ -1836,6 +2039,15 @@ static int lan887x_hwtstamp(struct mii_timestamper *mii_ts, struct ifreq *ifr)
 	if (copy_from_user(&config, ifr->ifr_data, sizeof(config)))
 		return -EFAULT;
 
+	switch (config.tx_type) {
+	case HWTSTAMP_TX_OFF:
+	case HWTSTAMP_TX_ON:
+	case HWTSTAMP_TX_ONESTEP_SYNC:
+		break;
+	default:
+		return -ERANGE;
+	}
+
 	ptp_priv->hwts_tx_type = config.tx_type;
 	ptp_priv->rx_filter = config.rx_filter;
 
@@ -1888,6 +2100,10 @@ static int lan887x_hwtstamp(struct mii_timestamper *mii_ts, struct ifreq *ifr)
 	phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_TIMESTAMP_EN,
 		      PTP_TIMESTAMP_EN_ALL_);
 
+	/* Sync capture stays enabled in one-step mode as on LAN8814, the
+	 * insertion is not documented to work without it. The FIFO entries
+	 * of one-step Sync frames are dropped in lan887x_match_tx_skb().
+	 */
 	phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_TIMESTAMP_EN,
 		      PTP_TIMESTAMP_EN_ALL_);
 
@@ -1908,11 +2124,8 @@ static int lan887x_hwtstamp(struct mii_timestamper *mii_ts, struct ifreq *ifr)
 				config.rx_filter != HWTSTAMP_FILTER_NONE);
 
 	/* In case of multiple starts and stops, these needs to be cleared */
-	list_for_each_entry_safe(rx_ts, tmp, &ptp_priv->rx_ts_list, list) {
-		list_del(&rx_ts->list);
-		kfree(rx_ts);
-	}
-	skb_queue_purge(&ptp_priv->rx_queue);
+	lan887x_ptp_purge_rx_ts(ptp_priv);
+	lan887x_ptp_purge_rx_skbs(ptp_priv);
 	skb_queue_purge(&ptp_priv->tx_queue);
 
 	lan887x_ptp_flush_fifo(ptp_priv, false);
@@ -1984,110 +2197,6 @@ static int lan887x_set_clock_target(struct phy_device *phydev, s8 event,
 			     upper_16_bits(start_nsec) & 0x3fff);
 }
 
-static int lan887x_ltc_adjtime(struct ptp_clock_info *info, s64 delta)
-{
-	struct lan887x_ptp_priv *ptp_priv = container_of(info, struct lan887x_ptp_priv, caps);
-	struct phy_device *phydev = ptp_priv->phydev;
-	struct timespec64 ts;
-	bool add = true;
-	int ret = 0;
-	u32 nsec;
-	s32 sec;
-
-	/* The HW allows up to 15 sec to adjust the time, but here we limit to
-	 * 10 sec the adjustment. The reason is, in case the adjustment is 14
-	 * sec and 999999999 nsec, then we add 8ns to compansate the actual
-	 * increment so the value can be bigger than 15 sec. Therefore limit the
-	 * possible adjustments so we will not have these corner cases
-	 */
-	if (delta > 10000000000LL || delta < -10000000000LL) {
-		/* The timeadjustment is too big, so fall back using set time */
-		u64 now;
-
-		info->gettime64(info, &ts);
-
-		now = ktime_to_ns(timespec64_to_ktime(ts));
-		ts = ns_to_timespec64(now + delta);
-
-		info->settime64(info, &ts);
-		return 0;
-	}
-	sec = div_u64_rem(delta < 0 ? -delta : delta, NSEC_PER_SEC, &nsec);
-	if (delta < 0 && nsec != 0) {
-		/* It is not allowed to adjust low the nsec part, therefore
-		 * subtract more from second part and add to nanosecond such
-		 * that would roll over, so the second part will increase
-		 */
-		sec--;
-		nsec = NSEC_PER_SEC - nsec;
-	}
-
-	/* Calculate the adjustments and the direction */
-	if (delta < 0)
-		add = false;
-
-	if (nsec > 0)
-		/* add 8 ns to cover the likely normal increment */
-		nsec += 8;
-
-	if (nsec >= NSEC_PER_SEC) {
-		/* carry into seconds */
-		sec++;
-		nsec -= NSEC_PER_SEC;
-	}
-
-	mutex_lock(&ptp_priv->ptp_lock);
-	if (sec) {
-		if (sec < 0)
-			sec = -sec;
-
-		ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_LO, sec);
-		if (ret < 0)
-			goto out_unlock;
-		ret = phy_set_bits_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_HI,
-				       ((add ? LAN887X_PTP_LTC_STEP_ADJ_HI_DIR : 0) |
-					((sec >> 16) & 0x3fff)));
-		if (ret < 0)
-			goto out_unlock;
-		ret = phy_set_bits_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_CMD_CTL,
-				       LAN887X_PTP_CMD_CTL_PTP_LTC_STEP_SECONDS);
-		if (ret < 0)
-			goto out_unlock;
-	}
-
-	if (nsec) {
-		ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_LO,
-				    nsec & LAN887X_DEF_MASK);
-		if (ret < 0)
-			goto out_unlock;
-		ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_HI,
-				    (nsec >> 16) & 0x3fff);
-		if (ret < 0)
-			goto out_unlock;
-		ret = phy_set_bits_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_CMD_CTL,
-				       LAN887X_PTP_CMD_CTL_PTP_LTC_STEP_NANOSECONDS);
-		if (ret < 0)
-			goto out_unlock;
-	}
-	mutex_unlock(&ptp_priv->ptp_lock);
-	info->gettime64(info, &ts);
-	mutex_lock(&ptp_priv->ptp_lock);
-
-	/* Target update is required for pulse generation on events that are enabled */
-	if (ptp_priv->lan887x_event_a >= 0)
-		lan887x_set_clock_target(phydev, LAN887X_EVENT_A,
-					 ts.tv_sec + LAN887X_BUFFER_TIME, 0);
-
-	if (ptp_priv->lan887x_event_b >= 0)
-		lan887x_set_clock_target(phydev, LAN887X_EVENT_B,
-					 ts.tv_sec + LAN887X_BUFFER_TIME, 0);
-
-out_unlock:
-	mutex_unlock(&ptp_priv->ptp_lock);
-
-	return ret;
-}
-
 static int lan887x_ltc_adjfine(struct ptp_clock_info *info, long scaled_ppm)
 {
 	struct lan887x_ptp_priv *ptp_priv = container_of(info,
@@ -2096,11 +2205,9 @@ static int lan887x_ltc_adjfine(struct ptp_clock_info *info, long scaled_ppm)
 	struct phy_device *phydev = ptp_priv->phydev;
 	u16 rate_lo, rate_hi;
 	bool faster = true;
+	int ret = 0;
 	u32 rate;
 
-	if (!scaled_ppm)
-		return 0;
-
 	if (scaled_ppm < 0) {
 		scaled_ppm = -scaled_ppm;
 		faster = false;
@@ -2115,40 +2222,72 @@ static int lan887x_ltc_adjfine(struct ptp_clock_info *info, long scaled_ppm)
 	if (faster)
 		rate_hi |= LAN887X_PTP_LTC_RATE_ADJ_HI_DIR;
 
+	/* Only write the halves that differ from what the LTC already has */
 	mutex_lock(&ptp_priv->ptp_lock);
-	phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_RATE_ADJ_HI, rate_hi);
-	phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_RATE_ADJ_LO, rate_lo);
+	if (!ptp_priv->rate_valid || ptp_priv->rate_hi != rate_hi) {
+		ptp_priv->rate_valid = false;
+		ret = phy_write_mmd(phydev, MDIO_MMD_VEND1,
+				    LAN887X_PTP_LTC_RATE_ADJ_HI, rate_hi);
+		if (ret < 0)
+			goto out_unlock;
+		ptp_priv->rate_hi = rate_hi;
+		ptp_priv->stats.rate_writes++;
+	} else {
+		ptp_priv->stats.rate_writes_skipped++;
+	}
+
+	if (!ptp_priv->rate_valid || ptp_priv->rate_lo != rate_lo) {
+		ptp_priv->rate_valid = false;
+		ret = phy_write_mmd(phydev, MDIO_MMD_VEND1,
+				    LAN887X_PTP_LTC_RATE_ADJ_LO, rate_lo);
+		if (ret < 0)
+			goto out_unlock;
+		ptp_priv->rate_lo = rate_lo;
+		ptp_priv->stats.rate_writes++;
+	} else {
+		ptp_priv->stats.rate_writes_skipped++;
+	}
+	ptp_priv->rate_valid = true;
+
+out_unlock:
 	mutex_unlock(&ptp_priv->ptp_lock);
 
-	return 0;
+	return ret;
 }
 
-static int lan887x_ltc_gettime64(struct ptp_clock_info *info,
-				 struct timespec64 *ts)
+/* Called with ptp_lock held */
+static int lan887x_ltc_read(struct lan887x_ptp_priv *ptp_priv,
+			    struct timespec64 *ts,
+			    struct ptp_system_timestamp *sts)
 {
-	struct lan887x_ptp_priv *ptp_priv = container_of(info,
-							 struct lan887x_ptp_priv, caps);
 	struct phy_device *phydev = ptp_priv->phydev;
 	time64_t secs;
+	ktime_t mono;
 	int ret = 0;
 	s64 nsecs;
 
-	mutex_lock(&ptp_priv->ptp_lock);
 	/* Set READ bit to 1 to save current values of 1588 Local Time Counter
-	 * into PTP LTC seconds and nanoseconds registers.
+	 * into PTP LTC seconds and nanoseconds registers. The bit is a self
+	 * clearing command, so a single write latches the clock and only that
+	 * write is bracketed by the system timestamps.
 	 */
-	ret = phy_set_bits_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_CMD_CTL,
-			       LAN887X_PTP_CMD_CTL_CLOCK_READ);
+	phy_lock_mdio_bus(phydev);
+	ptp_read_system_prets(sts);
+	ret = __phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_CMD_CTL,
+			      LAN887X_PTP_CMD_CTL_CLOCK_READ);
+	ptp_read_system_postts(sts);
+	mono = ktime_get();
+	phy_unlock_mdio_bus(phydev);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to set PTP_CLOCK_READ bit\n");
-		goto out_unlock;
+		return ret;
 	}
 
 	/* Get LTC clock values */
 	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_READ_SEC_HI);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to read PTP_LTC_READ_SEC_HI reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	secs = (ret & LAN887X_DEF_MASK);
 	secs <<= 16;
@@ -2156,7 +2295,7 @@ static int lan887x_ltc_gettime64(struct ptp_clock_info *info,
 	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_READ_SEC_MID);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to read PTP_LTC_READ_SEC_MID reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	secs |= (ret & LAN887X_DEF_MASK);
 	secs <<= 16;
@@ -2164,14 +2303,14 @@ static int lan887x_ltc_gettime64(struct ptp_clock_info *info,
 	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_READ_SEC_LO);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to read PTP_LTC_READ_SEC_LO reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	secs |= (ret & LAN887X_DEF_MASK);
 
 	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_READ_NS_HI);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to read PTP_LTC_READ_NS_HI reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	nsecs = (ret & 0x3fff);
 	nsecs <<= 16;
@@ -2179,56 +2318,76 @@ static int lan887x_ltc_gettime64(struct ptp_clock_info *info,
 	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_READ_NS_LO);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to read PTP_LTC_READ_NS_LO reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	nsecs |= (ret & LAN887X_DEF_MASK);
 
 	set_normalized_timespec64(ts, secs, nsecs);
 
-out_unlock:
-	mutex_unlock(&ptp_priv->ptp_lock);
+	ptp_priv->ltc_ref = *ts;
+	ptp_priv->ltc_ref_mono = mono;
+	ptp_priv->ltc_ref_valid = true;
 
 	return 0;
 }
 
-static int lan887x_ltc_settime64(struct ptp_clock_info *info,
-				 const struct timespec64 *ts)
+static int lan887x_ltc_gettimex64(struct ptp_clock_info *info,
+				  struct timespec64 *ts,
+				  struct ptp_system_timestamp *sts)
 {
 	struct lan887x_ptp_priv *ptp_priv = container_of(info,
 							 struct lan887x_ptp_priv, caps);
-	struct phy_device *phydev = ptp_priv->phydev;
 	int ret;
 
 	mutex_lock(&ptp_priv->ptp_lock);
+	ret = lan887x_ltc_read(ptp_priv, ts, sts);
+	mutex_unlock(&ptp_priv->ptp_lock);
+
+	return ret;
+}
+
+static int lan887x_ltc_gettime64(struct ptp_clock_info *info,
+				 struct timespec64 *ts)
+{
+	return lan887x_ltc_gettimex64(info, ts, NULL);
+}
+
+/* Called with ptp_lock held */
+static int lan887x_ltc_write(struct lan887x_ptp_priv *ptp_priv,
+			     const struct timespec64 *ts)
+{
+	struct phy_device *phydev = ptp_priv->phydev;
+	int ret;
+
 	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_SEC_LO,
 			    lower_16_bits(ts->tv_sec));
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to write PTP_LTC_SEC_LO reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_SEC_MID,
 			    upper_16_bits(ts->tv_sec));
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to write PTP_LTC_SEC_MID reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_SEC_HI,
 			    upper_32_bits(ts->tv_sec) & 0xffff);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to write PTP_LTC_SEC_HI reg\n");
-		goto out_unlock;
+		return ret;
 	}
 	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_NS_LO,
 			    lower_16_bits(ts->tv_nsec));
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to write PTP_LTC_NS_LO register\n");
-		goto out_unlock;
+		return ret;
 	}
 	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_NS_HI,
 			    upper_16_bits(ts->tv_nsec) & 0x3fff);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to write PTP_LTC_NS_HI register\n");
-		goto out_unlock;
+		return ret;
 	}
 
 	/* Set LOAD bit to 1 to write PTP LTC seconds and nanoseconds
@@ -2238,137 +2397,305 @@ static int lan887x_ltc_settime64(struct ptp_clock_info *info,
 			       LAN887X_PTP_CMD_CTL_CLOCK_LOAD);
 	if (ret < 0) {
 		phydev_err(phydev, "Failed to set PTP_CLOCK_LOAD bit\n");
-		goto out_unlock;
+		return ret;
 	}
 
-out_unlock:
+	ptp_priv->ltc_ref = *ts;
+	ptp_priv->ltc_ref_mono = ktime_get();
+	ptp_priv->ltc_ref_valid = true;
+
+	return 0;
+}
+
+static int lan887x_ltc_settime64(struct ptp_clock_info *info,
+				 const struct timespec64 *ts)
+{
+	struct lan887x_ptp_priv *ptp_priv = container_of(info,
+							 struct lan887x_ptp_priv, caps);
+	int ret;
+
+	mutex_lock(&ptp_priv->ptp_lock);
+	ret = lan887x_ltc_write(ptp_priv, ts);
 	mutex_unlock(&ptp_priv->ptp_lock);
 
 	return ret;
 }
 
-static int lan887x_gpio_config_ptp_out(struct lan887x_ptp_priv *ptp_priv, s8 gpio_pin)
+/* Called with ptp_lock held */
+static int lan887x_ltc_step(struct phy_device *phydev, u16 step_hi,
+			    u16 step_lo, u16 cmd)
+{
+	int ret;
+
+	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_LO,
+			    step_lo);
+	if (ret < 0)
+		return ret;
+
+	ret = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_LTC_STEP_ADJ_HI,
+			    step_hi);
+	if (ret < 0)
+		return ret;
+
+	/* Step commands are self clearing, no need to preserve other bits */
+	return phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_CMD_CTL, cmd);
+}
+
+/* First edge of the event output grid at or after @after_ns */
+static s64 lan887x_event_next_edge(const struct lan887x_ptp_event *ev,
+				   s64 after_ns)
+{
+	u64 periods;
+
+	if (after_ns <= ev->start_ns)
+		return ev->start_ns;
+
+	periods = div64_u64(after_ns - ev->start_ns + ev->period_ns - 1,
+			    ev->period_ns);
+
+	return ev->start_ns + periods * ev->period_ns;
+}
+
+/* Called with ptp_lock held. Re-arm the event targets a few seconds ahead
+ * of the current LTC time, extrapolated from the last time the LTC was
+ * read, written or stepped so that no extra clock read is needed.
+ */
+static int lan887x_ltc_rearm_targets(struct lan887x_ptp_priv *ptp_priv)
 {
 	struct phy_device *phydev = ptp_priv->phydev;
-	int val, rc = 0;
+	struct lan887x_ptp_event *ev;
+	struct timespec64 ts;
+	bool active = false;
+	ktime_t age;
+	s64 now_ns;
+	int event;
+	int ret;
+
+	for (event = 0; event < LAN887X_N_PEROUT; event++)
+		active |= ptp_priv->event[event].pin >= 0;
+	if (!active)
+		return 0;
 
-	if (gpio_pin == ptp_priv->lan887x_event_b) {
-		/* Enable pin mux for GPIO 2 as ref clk(design team suggested bit for event b) */
-		val = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1);
-		val |= LAN887X_MX_CHIP_TOP_REG_CONTROL1_REF_CLK;
-		rc = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1,
-				   val);
+	age = ktime_sub(ktime_get(), ptp_priv->ltc_ref_mono);
+	if (ptp_priv->ltc_ref_valid && ktime_to_ms(age) < LAN887X_LTC_REF_MAX_AGE_MS) {
+		ts = timespec64_add(ptp_priv->ltc_ref, ktime_to_timespec64(age));
+	} else {
+		ret = lan887x_ltc_read(ptp_priv, &ts, NULL);
+		if (ret < 0)
+			return ret;
 	}
 
-	if (gpio_pin == ptp_priv->lan887x_event_a) {
-		/* Enable pin mux for EVT A */
-		val = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1);
-		val |= LAN887X_MX_CHIP_TOP_REG_CONTROL1_EVT_EN;
-		rc = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1,
-				   val);
+	now_ns = timespec64_to_ns(&ts) + (s64)LAN887X_BUFFER_TIME * NSEC_PER_SEC;
+
+	/* Target update is required for pulse generation on events that are enabled */
+	for (event = 0; event < LAN887X_N_PEROUT; event++) {
+		ev = &ptp_priv->event[event];
+		if (ev->pin < 0)
+			continue;
+
+		ts = ns_to_timespec64(lan887x_event_next_edge(ev, now_ns));
+		ret = lan887x_set_clock_target(phydev, event, ts.tv_sec,
+					       ts.tv_nsec);
+		if (ret < 0)
+			return ret;
 	}
 
-	return rc;
+	return 0;
 }
 
-static int lan887x_gpio_release(struct lan887x_ptp_priv *ptp_priv, s8 gpio_pin)
+static int lan887x_ltc_adjtime(struct ptp_clock_info *info, s64 delta)
 {
+	struct lan887x_ptp_priv *ptp_priv = container_of(info, struct lan887x_ptp_priv, caps);
 	struct phy_device *phydev = ptp_priv->phydev;
-	int val, rc;
+	struct timespec64 ts;
+	int ret = 0;
+	u32 nsec;
+	s32 rem;
+	s64 sec;
+
+	mutex_lock(&ptp_priv->ptp_lock);
+	if (delta > LAN887X_PTP_STEP_MAX_NS || delta < -LAN887X_PTP_STEP_MAX_NS) {
+		/* The timeadjustment is too big, so fall back using set time */
+		ret = lan887x_ltc_read(ptp_priv, &ts, NULL);
+		if (ret < 0)
+			goto out_unlock;
+
+		ts = ns_to_timespec64(timespec64_to_ns(&ts) + delta);
+		ret = lan887x_ltc_write(ptp_priv, &ts);
+		if (ret < 0)
+			goto out_unlock;
+
+		ret = lan887x_ltc_rearm_targets(ptp_priv);
+		goto out_unlock;
+	}
 
-	if (gpio_pin == ptp_priv->lan887x_event_b) {
-		/* Disable pin mux for GPIO 2 as Ref clk(design team suggested bit for event b) */
-		val = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1);
-		val &= ~LAN887X_MX_CHIP_TOP_REG_CONTROL1_REF_CLK;
-		rc = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1,
-				   val);
+	sec = div_s64_rem(delta, NSEC_PER_SEC, &rem);
+	if (rem < 0) {
+		/* It is not allowed to adjust low the nsec part, therefore
+		 * subtract one more second and add the complement in
+		 * nanoseconds
+		 */
+		sec--;
+		rem += NSEC_PER_SEC;
 	}
+	nsec = rem;
+
+	if (nsec > 0)
+		/* add 8 ns to cover the likely normal increment */
+		nsec += 8;
 
-	if (gpio_pin == ptp_priv->lan887x_event_a) {
-		/* Disable pin mux for EVT A */
-		val = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1);
-		val &= ~LAN887X_MX_CHIP_TOP_REG_CONTROL1_EVT_EN;
-		rc = phy_write_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_CHIP_TOP_REG_CONTROL1,
-				   val);
+	if (nsec >= NSEC_PER_SEC) {
+		/* carry into seconds */
+		sec++;
+		nsec -= NSEC_PER_SEC;
 	}
 
-	return rc;
+	if (sec) {
+		ret = lan887x_ltc_step(phydev,
+				       sec > 0 ? LAN887X_PTP_LTC_STEP_ADJ_HI_DIR : 0,
+				       sec > 0 ? sec : -sec,
+				       LAN887X_PTP_CMD_CTL_PTP_LTC_STEP_SECONDS);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	if (nsec) {
+		ret = lan887x_ltc_step(phydev, (nsec >> 16) & 0x3fff,
+				       nsec & LAN887X_DEF_MASK,
+				       LAN887X_PTP_CMD_CTL_PTP_LTC_STEP_NANOSECONDS);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	if (ptp_priv->ltc_ref_valid)
+		ptp_priv->ltc_ref = timespec64_add(ptp_priv->ltc_ref,
+						   ns_to_timespec64(delta));
+
+	ret = lan887x_ltc_rearm_targets(ptp_priv);
+
+out_unlock:
+	mutex_unlock(&ptp_priv->ptp_lock);
+
+	return ret;
+}
+
+/* There is no servoed phase adjustment: the LTC is stepped by @phase
+ * through adjtime, which is exact but not a slew.
+ */
+static int lan887x_ltc_adjphase(struct ptp_clock_info *info, s32 phase)
+{
+	return lan887x_ltc_adjtime(info, phase);
+}
+
+static s32 lan887x_ltc_getmaxphase(struct ptp_clock_info *info)
+{
+	return LAN887X_MAX_PHASE;
+}
+
+/* Pulse widths of the event outputs, indexed by GENERAL_CONFIG value */
+static const u32 lan887x_pulse_widths[] = {
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100NS_]	= 100,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_500NS_]	= 500,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_1US_]	= 1000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_5US_]	= 5000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_10US_]	= 10000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_50US_]	= 50000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100US_]	= 100000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_500US_]	= 500000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_1MS_]	= 1000000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_5MS_]	= 5000000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_10MS_]	= 10000000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_50MS_]	= 50000000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100MS_]	= 100000000,
+	[LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_200MS_]	= 200000000,
+};
+
+/* GPIOs that can carry an event output, the events that can be routed
+ * to them and the pin mux bit enabling the output
+ */
+struct lan887x_ptp_pin {
+	u8 pin;
+	u8 events;
+	u16 mux;
+};
+
+static const struct lan887x_ptp_pin lan887x_ptp_pins[] = {
+	/* EVT A */
+	{ 3, BIT(LAN887X_EVENT_A), LAN887X_MX_CHIP_TOP_REG_CONTROL1_EVT_EN },
+	/* GPIO 2 as ref clk(design team suggested bit for event b) */
+	{ 1, BIT(LAN887X_EVENT_B), LAN887X_MX_CHIP_TOP_REG_CONTROL1_REF_CLK },
+};
+
+static const struct lan887x_ptp_pin *lan887x_ptp_find_pin(unsigned int pin)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lan887x_ptp_pins); i++) {
+		if (lan887x_ptp_pins[i].pin == pin)
+			return &lan887x_ptp_pins[i];
+	}
+
+	return NULL;
+}
+
+static int lan887x_gpio_config_ptp_out(struct lan887x_ptp_priv *ptp_priv,
+				       const struct lan887x_ptp_pin *pin)
+{
+	return phy_set_bits_mmd(ptp_priv->phydev, MDIO_MMD_VEND1,
+				LAN887X_MX_CHIP_TOP_REG_CONTROL1, pin->mux);
+}
+
+static int lan887x_gpio_release(struct lan887x_ptp_priv *ptp_priv,
+				const struct lan887x_ptp_pin *pin)
+{
+	return phy_clear_bits_mmd(ptp_priv->phydev, MDIO_MMD_VEND1,
+				  LAN887X_MX_CHIP_TOP_REG_CONTROL1, pin->mux);
 }
 
 static int lan887x_get_pulsewidth(struct phy_device *phydev,
 				  struct ptp_perout_request *perout_request,
-				  int *pulse_width)
+				  s64 period_nsec, int *pulse_width)
 {
-	struct timespec64 ts_period;
-	s64 ts_on_nsec, period_nsec;
+	s64 ts_on_nsec, diff, best_diff = S64_MAX;
 	struct timespec64 ts_on;
+	int i;
 
-	ts_period.tv_sec = perout_request->period.sec;
-	ts_period.tv_nsec = perout_request->period.nsec;
-
-	ts_on.tv_sec = perout_request->on.sec;
-	ts_on.tv_nsec = perout_request->on.nsec;
-	ts_on_nsec = timespec64_to_ns(&ts_on);
-	period_nsec = timespec64_to_ns(&ts_period);
+	if (perout_request->flags & PTP_PEROUT_DUTY_CYCLE) {
+		ts_on.tv_sec = perout_request->on.sec;
+		ts_on.tv_nsec = perout_request->on.nsec;
+		ts_on_nsec = timespec64_to_ns(&ts_on);
 
-	if (period_nsec < 200) {
-		phydev_warn(phydev, "perout period too small, minimum is 200ns\n");
-		return -EOPNOTSUPP;
+		if (ts_on_nsec >= period_nsec) {
+			phydev_warn(phydev, "pulse width must be smaller than period\n");
+			return -EINVAL;
+		}
+	} else {
+		/* No duty cycle requested, aim for half the period */
+		ts_on_nsec = period_nsec >> 1;
 	}
 
-	if (ts_on_nsec >= period_nsec) {
-		phydev_warn(phydev, "pulse width must be smaller than period\n");
-		return -EINVAL;
+	/* Pick the closest supported width that still fits in the period */
+	*pulse_width = -1;
+	for (i = 0; i < ARRAY_SIZE(lan887x_pulse_widths); i++) {
+		if (lan887x_pulse_widths[i] >= period_nsec)
+			break;
+
+		diff = abs(ts_on_nsec - (s64)lan887x_pulse_widths[i]);
+		if (diff < best_diff) {
+			best_diff = diff;
+			*pulse_width = i;
+		}
 	}
 
-	switch (ts_on_nsec) {
-	case 200000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_200MS_;
-		break;
-	case 100000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100MS_;
-		break;
-	case 50000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_50MS_;
-		break;
-	case 10000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_10MS_;
-		break;
-	case 5000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_5MS_;
-		break;
-	case 1000000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_1MS_;
-		break;
-	case 500000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_500US_;
-		break;
-	case 100000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100US_;
-		break;
-	case 50000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_50US_;
-		break;
-	case 10000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_10US_;
-		break;
-	case 5000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_5US_;
-		break;
-	case 1000:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_1US_;
-		break;
-	case 500:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_500NS_;
-		break;
-	case 100:
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_100NS_;
-		break;
-	default:
-		phydev_warn(phydev, "Using default pulse width of 200ms\n");
-		*pulse_width = LAN887X_PTP_GENERAL_CONFIG_LTC_EVENT_200MS_;
-		break;
+	if (*pulse_width < 0) {
+		phydev_warn(phydev, "no supported pulse width fits the period\n");
+		return -EOPNOTSUPP;
 	}
+
+	if (lan887x_pulse_widths[*pulse_width] != ts_on_nsec)
+		phydev_dbg(phydev, "perout pulse width %lld ns, using %u ns\n",
+			   ts_on_nsec, lan887x_pulse_widths[*pulse_width]);
+
 	return 0;
 }
 
@@ -2414,52 +2741,103 @@ static int lan887x_set_clock_reload(struct phy_device *phydev, s8 event,
 			     upper_16_bits(period_nsec) & 0x3fff);
 }
 
-static int lan887x_get_event(struct lan887x_ptp_priv *ptp_priv, int pin)
+/* Called with ptp_lock held */
+static int lan887x_find_event(struct lan887x_ptp_priv *ptp_priv, int gpio_pin)
 {
-	if (ptp_priv->lan887x_event_a < 0 && pin == 3) {
-		ptp_priv->lan887x_event_a = pin;
-		return LAN887X_EVENT_A;
-	}
+	int event;
 
-	if (ptp_priv->lan887x_event_b < 0 && pin == 1) {
-		ptp_priv->lan887x_event_b = pin;
-		return LAN887X_EVENT_B;
+	for (event = 0; event < LAN887X_N_PEROUT; event++) {
+		if (ptp_priv->event[event].pin == gpio_pin)
+			return event;
 	}
 
 	return -1;
 }
 
+/* Called with ptp_lock held */
+static int lan887x_get_event(struct lan887x_ptp_priv *ptp_priv,
+			     const struct lan887x_ptp_pin *pin)
+{
+	int event;
+
+	/* Reuse the event already driving this pin */
+	event = lan887x_find_event(ptp_priv, pin->pin);
+	if (event >= 0)
+		return event;
+
+	for (event = 0; event < LAN887X_N_PEROUT; event++) {
+		if (!(pin->events & BIT(event)) ||
+		    ptp_priv->event[event].pin >= 0)
+			continue;
+
+		ptp_priv->event[event].pin = pin->pin;
+		return event;
+	}
+
+	return -EBUSY;
+}
+
+/* Called with ptp_lock held */
 static int lan887x_ptp_perout_off(struct lan887x_ptp_priv *ptp_priv,
-				  s8 gpio_pin)
+				  const struct lan887x_ptp_pin *pin)
 {
-	u16 general_config;
-	int event = -1;
+	struct phy_device *phydev = ptp_priv->phydev;
+	int event;
 	int rc;
 
-	if (ptp_priv->lan887x_event_a == gpio_pin)
-		event = LAN887X_EVENT_A;
-	else if (ptp_priv->lan887x_event_b == gpio_pin)
-		event = LAN887X_EVENT_B;
+	event = lan887x_find_event(ptp_priv, pin->pin);
+	if (event < 0)
+		return 0;
 
 	/* Set target to too far in the future, effectively disabling it */
-	rc = lan887x_set_clock_target(ptp_priv->phydev, gpio_pin, 0xFFFFFFFF, 0);
+	rc = lan887x_set_clock_target(phydev, event, 0xFFFFFFFF, 0);
 	if (rc < 0)
 		return rc;
 
-	general_config = phy_read_mmd(ptp_priv->phydev, MDIO_MMD_VEND1, LAN887X_PTP_GENERAL_CONFIG);
-	general_config |= LAN887X_PTP_GENERAL_CONFIG_RELOAD_ADD_X_(event);
-	rc = phy_write_mmd(ptp_priv->phydev, MDIO_MMD_VEND1,
-			   LAN887X_PTP_GENERAL_CONFIG, general_config);
+	rc = phy_set_bits_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_GENERAL_CONFIG,
+			      LAN887X_PTP_GENERAL_CONFIG_RELOAD_ADD_X_(event));
 	if (rc < 0)
 		return rc;
 
-	if (event == LAN887X_EVENT_A)
-		ptp_priv->lan887x_event_a = -1;
+	ptp_priv->event[event].pin = -1;
+
+	return lan887x_gpio_release(ptp_priv, pin);
+}
+
+/* Called with ptp_lock held */
+static int lan887x_ptp_perout_start(struct lan887x_ptp_priv *ptp_priv,
+				    struct ptp_perout_request *perout,
+				    s64 period_nsec, s64 *start_nsec)
+{
+	struct lan887x_ptp_event grid;
+	struct timespec64 ts;
+	s64 phase_nsec;
+	int ret;
 
-	if (event == LAN887X_EVENT_B)
-		ptp_priv->lan887x_event_b = -1;
+	ts.tv_sec = perout->start.sec;
+	ts.tv_nsec = perout->start.nsec;
+	*start_nsec = timespec64_to_ns(&ts);
 
-	return lan887x_gpio_release(ptp_priv, gpio_pin);
+	if (!(perout->flags & PTP_PEROUT_PHASE))
+		return 0;
+
+	/* start holds the phase of the edges within the period instead of
+	 * an absolute time, place the first edge a few seconds from now
+	 */
+	phase_nsec = *start_nsec;
+	if (phase_nsec < 0 || phase_nsec >= period_nsec)
+		return -ERANGE;
+
+	ret = lan887x_ltc_read(ptp_priv, &ts, NULL);
+	if (ret < 0)
+		return ret;
+
+	grid.start_ns = phase_nsec;
+	grid.period_ns = period_nsec;
+	*start_nsec = lan887x_event_next_edge(&grid, timespec64_to_ns(&ts) +
+					      (s64)LAN887X_BUFFER_TIME * NSEC_PER_SEC);
+
+	return 0;
 }
 
 static int lan887x_ptp_perout(struct ptp_clock_info *ptpci,
@@ -2467,45 +2845,83 @@ static int lan887x_ptp_perout(struct ptp_clock_info *ptpci,
 {
 	struct lan887x_ptp_priv *ptp_priv = container_of(ptpci, struct lan887x_ptp_priv, caps);
 	struct phy_device *phydev = ptp_priv->phydev;
+	const struct lan887x_ptp_pin *pin;
 	int ret, event, gpio_pin, pulsewidth;
+	s64 period_nsec, start_nsec;
+	struct timespec64 ts;
 
 	/* Reject requests with unsupported flags */
-	if (perout->flags & ~PTP_PEROUT_DUTY_CYCLE)
+	if (perout->flags & ~(PTP_PEROUT_DUTY_CYCLE | PTP_PEROUT_PHASE))
 		return -EOPNOTSUPP;
 
 	gpio_pin = ptp_find_pin(ptp_priv->ptp_clock, PTP_PF_PEROUT, perout->index);
 	if (gpio_pin < 0)
 		return -EBUSY;
 
+	pin = lan887x_ptp_find_pin(gpio_pin);
+	if (!pin)
+		return -EINVAL;
+
+	mutex_lock(&ptp_priv->ptp_lock);
 	if (!on) {
-		lan887x_ptp_perout_off(ptp_priv, gpio_pin);
-		return 0;
+		ret = lan887x_ptp_perout_off(ptp_priv, pin);
+		goto out_unlock;
+	}
+
+	ts.tv_sec = perout->period.sec;
+	ts.tv_nsec = perout->period.nsec;
+	period_nsec = timespec64_to_ns(&ts);
+
+	if (period_nsec < 200) {
+		phydev_warn(phydev, "perout period too small, minimum is 200ns\n");
+		ret = -EOPNOTSUPP;
+		goto out_unlock;
 	}
 
-	ret = lan887x_get_pulsewidth(phydev, perout, &pulsewidth);
+	ret = lan887x_get_pulsewidth(phydev, perout, period_nsec, &pulsewidth);
 	if (ret < 0)
-		return ret;
+		goto out_unlock;
 
-	event = lan887x_get_event(ptp_priv, gpio_pin);
-	if (event < 0)
-		return event;
+	ret = lan887x_ptp_perout_start(ptp_priv, perout, period_nsec, &start_nsec);
+	if (ret < 0)
+		goto out_unlock;
+
+	event = lan887x_get_event(ptp_priv, pin);
+	if (event < 0) {
+		ret = event;
+		goto out_unlock;
+	}
+
+	ptp_priv->event[event].start_ns = start_nsec;
+	ptp_priv->event[event].period_ns = period_nsec;
 
 	/* Configure to pulse every period */
 	ret = lan887x_general_event_config(phydev, event, pulsewidth);
 	if (ret < 0)
-		return ret;
+		goto err_release;
 
-	ret = lan887x_set_clock_target(phydev, event, perout->start.sec,
-				       perout->start.nsec);
+	ts = ns_to_timespec64(start_nsec);
+	ret = lan887x_set_clock_target(phydev, event, ts.tv_sec, ts.tv_nsec);
 	if (ret < 0)
-		return ret;
+		goto err_release;
 
 	ret = lan887x_set_clock_reload(phydev, event, perout->period.sec,
 				       perout->period.nsec);
 	if (ret < 0)
-		return ret;
+		goto err_release;
 
-	return lan887x_gpio_config_ptp_out(ptp_priv, gpio_pin);
+	ret = lan887x_gpio_config_ptp_out(ptp_priv, pin);
+	if (ret < 0)
+		goto err_release;
+
+	goto out_unlock;
+
+err_release:
+	ptp_priv->event[event].pin = -1;
+out_unlock:
+	mutex_unlock(&ptp_priv->ptp_lock);
+
+	return ret;
 }
 
 static int lan887x_ptpci_enable(struct ptp_clock_info *ptpci,
@@ -2522,13 +2938,13 @@ static int lan887x_ptpci_enable(struct ptp_clock_info *ptpci,
 static int lan887x_ptpci_verify(struct ptp_clock_info *ptpci, unsigned int pin,
 				enum ptp_pin_function func, unsigned int chan)
 {
-	/* 1 for event b and 3 for event a*/
-	if (!(pin == 1 && chan == 1) && !(pin == 3 && chan == 0))
-		return -1;
-
 	switch (func) {
 	case PTP_PF_NONE:
+		break;
 	case PTP_PF_PEROUT:
+		/* Any perout channel can use any pin able to carry an event */
+		if (!lan887x_ptp_find_pin(pin) || chan >= LAN887X_N_PEROUT)
+			return -1;
 		break;
 	default:
 		return -1;
@@ -2539,6 +2955,8 @@ static int lan887x_ptpci_verify(struct ptp_clock_info *ptpci, unsigned int pin,
 
 static void lan887x_ptp_init(struct phy_device *phydev)
 {
+	struct lan887x_priv *priv = phydev->priv;
+	struct lan887x_ptp_priv *ptp_priv = &priv->ptp_priv;
 	int i;
 
 	static const struct lan887x_regwr_map reg_wr[] = {
@@ -2581,6 +2999,14 @@ static void lan887x_ptp_init(struct phy_device *phydev)
 		phy_write_mmd(phydev, reg_wr[i].mmd,
 			      reg_wr[i].reg, reg_wr[i].val);
 	}
+
+	/* The LTC was hard reset, drop the cached view of it */
+	if (ptp_priv->ptp_clock) {
+		mutex_lock(&ptp_priv->ptp_lock);
+		ptp_priv->ltc_ref_valid = false;
+		ptp_priv->rate_valid = false;
+		mutex_unlock(&ptp_priv->ptp_lock);
+	}
 }
 
 static int lan887x_ptp_probe(struct phy_device *phydev)
@@ -2601,6 +3027,13 @@ static int lan887x_ptp_probe(struct phy_device *phydev)
 	if (!ptp_priv->pin_config)
 		return -ENOMEM;
 
+	ptp_priv->rx_ts_pool = devm_kcalloc(&phydev->mdio.dev,
+					    LAN887X_PTP_RX_TS_POOL_SIZE,
+					    sizeof(*ptp_priv->rx_ts_pool),
+					    GFP_KERNEL);
+	if (!ptp_priv->rx_ts_pool)
+		return -ENOMEM;
+
 	for (i = 0; i < LAN887X_N_GPIO; ++i) {
 		struct ptp_pin_desc *p = &ptp_priv->pin_config[i];
 
@@ -2621,9 +3054,13 @@ static int lan887x_ptp_probe(struct phy_device *phydev)
 	ptp_priv->caps.pin_config     = ptp_priv->pin_config;
 	ptp_priv->caps.adjfine        = lan887x_ltc_adjfine;
 	ptp_priv->caps.adjtime        = lan887x_ltc_adjtime;
+	ptp_priv->caps.adjphase       = lan887x_ltc_adjphase;
+	ptp_priv->caps.getmaxphase    = lan887x_ltc_getmaxphase;
 	ptp_priv->caps.gettime64      = lan887x_ltc_gettime64;
+	ptp_priv->caps.gettimex64     = lan887x_ltc_gettimex64;
 	ptp_priv->caps.settime64      = lan887x_ltc_settime64;
 	ptp_priv->caps.getcrosststamp = NULL;
+	ptp_priv->caps.do_aux_work    = lan887x_ptp_do_aux_work;
 	ptp_priv->caps.enable = lan887x_ptpci_enable;
 	ptp_priv->caps.verify = lan887x_ptpci_verify;
 	ptp_priv->ptp_clock = ptp_clock_register(&ptp_priv->caps,
@@ -2639,8 +3076,12 @@ static int lan887x_ptp_probe(struct phy_device *phydev)
 
 	/* Initialize the SW */
 	skb_queue_head_init(&ptp_priv->tx_queue);
-	skb_queue_head_init(&ptp_priv->rx_queue);
-	INIT_LIST_HEAD(&ptp_priv->rx_ts_list);
+	for (i = 0; i < LAN887X_PTP_HASH_SIZE; i++)
+		__skb_queue_head_init(&ptp_priv->rx_skb_hash[i]);
+	hash_init(ptp_priv->rx_ts_hash);
+	init_llist_head(&ptp_priv->rx_ts_free);
+	for (i = 0; i < LAN887X_PTP_RX_TS_POOL_SIZE; i++)
+		lan887x_rx_ts_free(ptp_priv, &ptp_priv->rx_ts_pool[i]);
 	spin_lock_init(&ptp_priv->rx_ts_lock);
 	ptp_priv->phydev = phydev;
 	mutex_init(&ptp_priv->ptp_lock);
@@ -2652,8 +3093,8 @@ static int lan887x_ptp_probe(struct phy_device *phydev)
 
 	phydev->mii_ts = &ptp_priv->mii_ts;
 
-	ptp_priv->lan887x_event_a = -1;
-	ptp_priv->lan887x_event_b = -1;
+	for (i = 0; i < LAN887X_N_PEROUT; i++)
+		ptp_priv->event[i].pin = -1;
 
 	//phydev_dbg(phydev, "Configuration of PHY PTP Block is complete!\n");
 
@@ -2693,13 +3134,20 @@ static void lan887x_match_tx_skb(struct lan887x_ptp_priv *ptp_priv,
 	}
 	spin_unlock_irqrestore(&ptp_priv->tx_queue.lock, flags);
 
-	if (ret) {
-		memset(&shhwtstamps, 0, sizeof(shhwtstamps));
-		shhwtstamps.hwtstamp = ktime_set(seconds, nsec);
-		skb_complete_tx_timestamp(skb, &shhwtstamps);
+	/* one-step Sync frames have no clone waiting, their entry is
+	 * simply dropped
+	 */
+	if (!ret) {
+		ptp_priv->stats.tx_ts_unmatched++;
+		return;
 	}
+
+	memset(&shhwtstamps, 0, sizeof(shhwtstamps));
+	shhwtstamps.hwtstamp = ktime_set(seconds, nsec);
+	skb_complete_tx_timestamp(skb, &shhwtstamps);
 }
 
+/* Called with the MDIO bus lock held */
 static struct lan887x_ptp_rx_ts *lan887x_ptp_get_rx_ts(struct lan887x_ptp_priv *ptp_priv)
 {
 	struct phy_device *phydev = ptp_priv->phydev;
@@ -2708,7 +3156,7 @@ static struct lan887x_ptp_rx_ts *lan887x_ptp_get_rx_ts(struct lan887x_ptp_priv *
 	u16 seq;
 	int ret;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_NS_HI);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_NS_HI);
 	nsec = (ret & LAN887X_DEF_MASK);
 	if (!(nsec & LAN887X_PTP_RX_INGRESS_NS_HI_PTP_RX_TS_VALID)) {
 		phydev_err(phydev, "RX Timestamp is not valid!\n");
@@ -2716,20 +3164,20 @@ static struct lan887x_ptp_rx_ts *lan887x_ptp_get_rx_ts(struct lan887x_ptp_priv *
 	}
 	nsec = (nsec & 0x3fff) << 16;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_NS_LO);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_NS_LO);
 	nsec |= (ret & LAN887X_DEF_MASK);
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_SEC_HI);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_SEC_HI);
 	sec = (ret & LAN887X_DEF_MASK);
 	sec <<= 16;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_SEC_LO);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_INGRESS_SEC_LO);
 	sec |= (ret & LAN887X_DEF_MASK);
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_MSG_HEADER2);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_RX_MSG_HEADER2);
 	seq = (ret & LAN887X_DEF_MASK);
 
-	rx_ts = kzalloc(sizeof(*rx_ts), GFP_KERNEL);
+	rx_ts = lan887x_rx_ts_alloc(ptp_priv);
 	if (!rx_ts)
 		return NULL;
 
@@ -2740,44 +3188,74 @@ static struct lan887x_ptp_rx_ts *lan887x_ptp_get_rx_ts(struct lan887x_ptp_priv *
 	return rx_ts;
 }
 
+/* Called with the MDIO bus lock held */
+static int lan887x_ptp_get_ts_cnt(struct phy_device *phydev, bool egress)
+{
+	int ret;
+
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_MX_PTP_PRT_CAP_INFO_REG);
+	if (ret < 0)
+		return 0;
+
+	ret = egress ? LAN887X_MX_PTP_PRT_TX_TS_CNT_GET(ret) :
+		       LAN887X_MX_PTP_PRT_RX_TS_CNT_GET(ret);
+
+	return min_t(int, ret, FIFO_SIZE);
+}
+
 static void lan887x_ptp_process_rx_ts(struct lan887x_ptp_priv *ptp_priv)
 {
+	struct lan887x_ptp_rx_ts *rx_ts[FIFO_SIZE];
 	struct phy_device *phydev = ptp_priv->phydev;
+	int cnt, n = 0, i;
+	bool trace;
+	u64 start;
 
-	do {
-		struct lan887x_ptp_rx_ts *rx_ts;
+	/* Read the capture count once and drain the whole burst in one
+	 * bus locked section, then match outside of it.
+	 */
+	trace = trace_lan887x_ptp_fifo_drain_enabled();
+	start = trace ? ktime_get_ns() : 0;
+	phy_lock_mdio_bus(phydev);
+	cnt = lan887x_ptp_get_ts_cnt(phydev, false);
+	for (i = 0; i < cnt; i++) {
+		rx_ts[n] = lan887x_ptp_get_rx_ts(ptp_priv);
+		if (rx_ts[n])
+			n++;
+	}
+	phy_unlock_mdio_bus(phydev);
+	if (trace)
+		trace_lan887x_ptp_fifo_drain(phydev, false, cnt,
+					     ktime_get_ns() - start);
 
-		rx_ts = lan887x_ptp_get_rx_ts(ptp_priv);
-		if (rx_ts)
-			lan887x_match_rx_ts(ptp_priv, rx_ts);
-	} while (LAN887X_MX_PTP_PRT_RX_TS_CNT_GET(phy_read_mmd(phydev, MDIO_MMD_VEND1,
-							       LAN887X_MX_PTP_PRT_CAP_INFO_REG
-							       )) > 0);
+	for (i = 0; i < n; i++)
+		lan887x_match_rx_ts(ptp_priv, rx_ts[i]);
 }
 
+/* Called with the MDIO bus lock held */
 static bool lan887x_ptp_get_tx_ts(struct lan887x_ptp_priv *ptp_priv,
 				  u32 *sec, u32 *nsec, u16 *seq)
 {
 	int ret;
 	struct phy_device *phydev = ptp_priv->phydev;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_NS_HI);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_NS_HI);
 	*nsec = (ret & LAN887X_DEF_MASK);
 	if (!(*nsec & LAN887X_PTP_TX_EGRESS_NS_HI_PTP_TX_TS_VALID))
 		return false;
 	*nsec = (*nsec & 0x3fff) << 16;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_NS_LO);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_NS_LO);
 	*nsec = *nsec | (ret & LAN887X_DEF_MASK);
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_SEC_HI);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_SEC_HI);
 	*sec = (ret & LAN887X_DEF_MASK);
 	*sec = *sec << 16;
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_SEC_LO);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_EGRESS_SEC_LO);
 	*sec = *sec | (ret & LAN887X_DEF_MASK);
 
-	ret = phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_MSG_HEADER2);
+	ret = __phy_read_mmd(phydev, MDIO_MMD_VEND1, LAN887X_PTP_TX_MSG_HEADER2);
 	*seq = (ret & LAN887X_DEF_MASK);
 
 	return true;
@@ -2786,16 +3264,32 @@ static bool lan887x_ptp_get_tx_ts(struct lan887x_ptp_priv *ptp_priv,
 static void lan887x_ptp_process_tx_ts(struct lan887x_ptp_priv *ptp_priv)
 {
 	struct phy_device *phydev = ptp_priv->phydev;
-
-	do {
-		u32 sec, nsec;
+	struct {
+		u32 sec;
+		u32 nsec;
 		u16 seq;
-
-		if (lan887x_ptp_get_tx_ts(ptp_priv, &sec, &nsec, &seq))
-			lan887x_match_tx_skb(ptp_priv, sec, nsec, seq);
-	} while (LAN887X_MX_PTP_PRT_TX_TS_CNT_GET(phy_read_mmd(phydev, MDIO_MMD_VEND1,
-							       LAN887X_MX_PTP_PRT_CAP_INFO_REG
-							       )) > 0);
+	} tx_ts[FIFO_SIZE];
+	int cnt, n = 0, i;
+	bool trace;
+	u64 start;
+
+	trace = trace_lan887x_ptp_fifo_drain_enabled();
+	start = trace ? ktime_get_ns() : 0;
+	phy_lock_mdio_bus(phydev);
+	cnt = lan887x_ptp_get_ts_cnt(phydev, true);
+	for (i = 0; i < cnt; i++) {
+		if (lan887x_ptp_get_tx_ts(ptp_priv, &tx_ts[n].sec,
+					  &tx_ts[n].nsec, &tx_ts[n].seq))
+			n++;
+	}
+	phy_unlock_mdio_bus(phydev);
+	if (trace)
+		trace_lan887x_ptp_fifo_drain(phydev, true, cnt,
+					     ktime_get_ns() - start);
+
+	for (i = 0; i < n; i++)
+		lan887x_match_tx_skb(ptp_priv, tx_ts[i].sec, tx_ts[i].nsec,
+				     tx_ts[i].seq);
 }
 
 static void lan887x_handle_ptp_interrupt(struct phy_device *phydev, int irq_status)
@@ -2815,8 +3309,9 @@ static void lan887x_handle_ptp_interrupt(struct phy_device *phydev, int irq_stat
 	}
 
 	if (irq_status & LAN887X_PTP_INT_RX_TS_OVRFL_EN) {
+		ptp_priv->stats.rx_fifo_overflow++;
 		lan887x_ptp_flush_fifo(ptp_priv, false);
-		skb_queue_purge(&ptp_priv->rx_queue);
+		lan887x_ptp_purge_rx_skbs(ptp_priv);
 	}
 }
 
@@ -3220,15 +3715,21 @@ static u64 lan887x_get_stat(struct phy_device *phydev, int i)
 static void lan887x_get_stats(struct phy_device *phydev,
 			      struct ethtool_stats *stats, u64 *data)
 {
+	struct lan887x_priv *priv = phydev->priv;
+	u8 *ptp_stats = (u8 *)&priv->ptp_priv.stats;
 	int i, idx = 0;
 
 	for (i = 0; i < ARRAY_SIZE(lan887x_hw_stats); i++)
 		data[idx++] = lan887x_get_stat(phydev, i);
+
+	// Software PTP stats
+	for (i = 0; i < ARRAY_SIZE(lan887x_ptp_stats); i++)
+		data[idx++] = *(u64 *)(ptp_stats + lan887x_ptp_stats[i].offset);
 }
 
 static int lan887x_get_sset_count(struct phy_device *phydev)
 {
-	return ARRAY_SIZE(lan887x_hw_stats);
+	return ARRAY_SIZE(lan887x_hw_stats) + ARRAY_SIZE(lan887x_ptp_stats);
 }
 
 static void lan887x_get_strings(struct phy_device *phydev, u8 *data)
@@ -3240,6 +3741,13 @@ static void lan887x_get_strings(struct phy_device *phydev, u8 *data)
 		strscpy(data + i * ETH_GSTRING_LEN,
 			lan887x_hw_stats[i].string, ETH_GSTRING_LEN);
 	}
+
+	// Software PTP stats
+	data += ARRAY_SIZE(lan887x_hw_stats) * ETH_GSTRING_LEN;
+	for (i = 0; i < ARRAY_SIZE(lan887x_ptp_stats); i++) {
+		strscpy(data + i * ETH_GSTRING_LEN,
+			lan887x_ptp_stats[i].string, ETH_GSTRING_LEN);
+	}
 }
 
 static int lan887x_config_intr(struct phy_device *phydev)
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2026 Microchip Technology */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM microchip_t1
+
+#if !defined(_MICROCHIP_T1_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MICROCHIP_T1_TRACE_H
+
+#include <linux/phy.h>
+#include <linux/tracepoint.h>
+
+/* One drain of the LAN887x PTP timestamp FIFO */
+TRACE_EVENT(lan887x_ptp_fifo_drain,
+
+	TP_PROTO(struct phy_device *phydev, bool egress, int entries,
+		 u64 duration_ns),
+
+	TP_ARGS(phydev, egress, entries, duration_ns),
+
+	TP_STRUCT__entry(
+		__string(dev, phydev_name(phydev))
+		__field(bool, egress)
+		__field(int, entries)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, phydev_name(phydev));
+		__entry->egress = egress;
+		__entry->entries = entries;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("%s %s entries=%d duration=%lluns",
+		  __get_str(dev), __entry->egress ? "tx" : "rx",
+		  __entry->entries, __entry->duration_ns)
+);
+
+#endif /* _MICROCHIP_T1_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/net/phy
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE microchip_t1_trace
+#include <trace/define_trace.h>